@@ -1,12 +1,18 @@
 #include "mbed.h"
 #include "scd30.h"
+#include "serial_tx.h"
 
 #define SDA0              PA_10 //PTE25
 #define SCL0              PA_9 //PTE24
+#define RDY0              NC   //SCD30 RDY pin if wired, NC = predictive polling
+#define MEAS_INTERVAL     5    //seconds
+#define STATS_EVERY       60   //bus statistics every n samples
+#define RESTART_MS        2000 //wait after the soft reset, scheduled in the queue
 
 
 
 RawSerial pc(USBTX, USBRX);
+serial_tx pcTx(pc);                            //non-blocking output for the measurement loop
 
 scd30 scd(SDA0, SCL0, 400000);                 //Microchip real time clock
 
@@ -14,24 +20,51 @@ scd30 scd(SDA0, SCL0, 400000);                 //Microchip real time clock
 // initial splash display
 
 void initSplash() {
-    pc.printf("\r\n\r\n");
-    pc.printf("-----------------------------------------------------------------------------\r\n");
+    pcTx.printf("\r\n\r\n");
+    pcTx.printf("-----------------------------------------------------------------------------\r\n");
 }
 
 //-----------------------------------------------------------------------------
-// initial the scd30
+// restart the scd30: soft reset now, sampling again RESTART_MS later from the
+// queue, nothing blocks the queue and all the output goes through pcTx
+
+EventQueue queue(32 * EVENTS_EVENT_SIZE);
+
+void startSCD30();
+void measurementDone(scd30::Measurement m);
 
 void initSCD30() {
-    pc.printf("Initializing SCD30...\r\n");
+    pcTx.printf("Initializing SCD30...\r\n");
+    scd.stopSampling();
     scd.softReset();
-    wait_ms(2000);
-    scd.getSerialNumber();
-    pc.printf(" - SCD30 s/n: ");
-    for(int i = 0; i < sizeof(scd.scdSTR.sn); i++) pc.printf("%c", scd.scdSTR.sn[i]);
-    pc.printf("\r\n");
-        
-    scd.setMeasInterval(5);
+    queue.call_in(RESTART_MS, startSCD30);
+}
+
+void startSCD30() {
+    if(scd.getSerialNumber() == scd30::SCDnoERROR) {
+        pcTx.printf(" - SCD30 s/n: %.*s\r\n", (int)sizeof(scd.scdSTR.sn), (const char *)scd.scdSTR.sn);
+    }
+    scd.setMeasInterval(MEAS_INTERVAL);
     scd.startMeasurement(0);
+    scd.startSampling(MEAS_INTERVAL, measurementDone, RDY0);
+}
+
+//-----------------------------------------------------------------------------
+// async callback, the driver reads each new sample (RDY pin or predictive poll)
+// while the queue does other work
+
+int count = 0;
+
+void measurementDone(scd30::Measurement m) {
+    count++;
+    if(m.status != scd30::SCDnoERROR) pcTx.printf("ERROR: %d\r\n", m.status);
+    else pcTx.printf("%5d  -> CO2: %9.3f   Temp: %7.3f   Hum: %5.2f\r\n", 
+                    count, m.co2, m.temp, m.hum);
+    if(count % STATS_EVERY == 0) {
+        pcTx.printf("bus: %.1f transactions/sample\r\n", scd.transactionsPerSample());
+        scd.resetStats();
+    }
+    if(m.status == scd30::SCDnoERROR && (int)m.co2 > 10000) initSCD30();
 }
 
 //-----------------------------------------------------------------------------
@@ -43,21 +76,10 @@ int main()
     wait_ms(200);
     initSplash();
        
+    scd.attachQueue(&queue);
     initSCD30();
-    int count = 0;
     
-    pc.printf("Ready...\r\n");
-    while(1) {
-        wait_ms(250);
-        scd.getReadyStatus();
-        uint16_t redy = scd.scdSTR.ready;
-        if(redy == scd30::SCDisReady) {
-            uint8_t crcc = scd.readMeasurement();
-            count++;
-            if(crcc != scd30::SCDnoERROR) pc.printf("ERROR: %d\r\n", crcc);
-            else pc.printf("%5d  -> CO2: %9.3f   Temp: %7.3f   Hum: %5.2f\r\n", 
-                            count, scd.scdSTR.co2f, scd.scdSTR.tempf, scd.scdSTR.humf);
-            if((int)scd.scdSTR.co2f > 10000) initSCD30();
-        }
-    }
+    pcTx.printf("Ready...\r\n");
+    queue.dispatch_forever();
+    return 0;
 }
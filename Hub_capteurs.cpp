@@ -0,0 +1,243 @@
+#include "mbed.h"
+#include "scd30.h"
+#include "max31865.h"
+#include "rtd_table.h"
+#include "filters.h"
+#include "pid.h"
+#include "telemetry.h"
+#include "serial_tx.h"
+#include "brew_log.h"
+#include "relay_output.h"
+
+//Programme unique pour une cuve : l'acquisition CO2 (scd30) et la régulation de température (max31865 + PID)
+//tournent comme tâches coopératives sur une seule EventQueue, chacune à sa cadence, et partagent une seule
+//sortie télémétrie. Il remplace C02main.cpp + Regulation_temperature.cpp sur deux microcontrolleurs.
+
+
+#define SDA0                    PA_10
+#define SCL0                    PA_9
+
+#define PERIODE_REGULATION_MS   1000  //une mesure de température et une mise à jour du PID par période
+#define PERIODE_TELEMETRIE_MS   1000  //une trame avec toutes les voies
+#define INTERVALLE_SCD30_S      5     //intervalle de mesure du scd30
+#define DEMARRAGE_SCD30_MS      2000  //attente après le soft reset du scd30, programmée dans la file (pas de wait)
+#define FENETRE_RELAIS_MS       5000  //une impulsion du relais par fenêtre, proportionnelle à la puissance
+#define MINIMUM_RELAIS_MS       500   //impulsion et coupure les plus courtes envoyées au relais (le reste est reporté)
+#define COMMANDE_STATS          's'   //caractère reçu sur pc : affiche les statistiques des bus SPI/I2C
+#define ESPACEMENT_STATS        250   //ms entre deux lignes des statistiques : une ligne part avant la suivante, le buffer d'envoi ne déborde pas
+#define RDY_SCD30               NC    //broche RDY du scd30 si elle est câblée, NC = interrogation juste avant la mesure attendue
+#define PERIODE_JOURNAL_S       60    //un échantillon dans le journal (3 semaines de brassin : 504 blocs, 252 Ko avec FLUSH_JOURNAL_S)
+#define FLUSH_JOURNAL_S         3600  //on écrit le bloc en cours même incomplet : au pire une heure perdue à la coupure
+
+
+//initialisation de l'I/O
+RawSerial pc(SERIAL_TX, SERIAL_RX);
+serial_tx Lien_pc(pc);//affichages depuis les tâches sous interruption, ils ne retardent pas la file
+RawSerial Mbed(PB_6,PB_7);
+serial_tx Lien_Mbed(Mbed);//sortie télémétrie commune, envoyée sous interruption
+scd30 scd(SDA0, SCL0, 400000);
+max31865 PT100(PB_5, PB_4, PB_3, PA_11); // MOSI, MISO, SCLK, CS - D11, D12, D13, D10
+Timer timer;
+EventQueue File_evenements(32 * EVENTS_EVENT_SIZE);
+relay_output Relais(PA_8, &File_evenements, FENETRE_RELAIS_MS, MINIMUM_RELAIS_MS, MINIMUM_RELAIS_MS);//pinout relay  /!\ le relay est normalement ouvert -> Relais = 1 -> circuit fermé
+median_filter<int, 3> Filtre_PT100;
+constexpr rtd_table<> Table_PT100(430.0, 100.0);
+BlockDevice *Stockage = BlockDevice::get_default_instance();//carte SD ou flash selon la cible, NULL si la cible n'en a pas
+brew_log *Journal = NULL;//température, CO2, humidité ; créé dans main() si le stockage répond
+
+
+// Déclaration des variables
+float Kp = 0.01, Ki = 0, Kd = 0, Tf = 0,Temperature_consigne = 40;
+pid<float> Regulateur(Kp, Ki, Kd, PERIODE_REGULATION_MS / 1000.0f, Tf);
+float Temperature_mesuree = 0, CO2_mesure = 0, Humidite_mesuree = 0;
+bool Temperature_valide = false, CO2_valide = false;
+bool Sonde_en_defaut = false;
+uint8_t Numero_trame = 0;
+
+
+// Déclaration des fonctions
+void Init_SCD30(void);
+void Demarrage_SCD30(void);
+void Tache_regulation(void);
+void Tache_telemetrie(void);
+void SCD30_mesure(scd30::Measurement mesure);
+void Tache_journal(void);
+void Reception_pc(void);
+void Affiche_stats_bus(int bus);
+void Flush_journal(void);
+
+
+//-------------------------------------------------------------------------------------------------------------
+//-------------------------------------------------------------------------------------------------------------
+
+//Début du programme
+int main(void)
+{
+//Mise en place des paramètres non changent
+    PT100.Begin(MAX31865_3WIRE);
+    Relais.Start();
+    timer.start();
+    scd.attachQueue(&File_evenements);
+    Init_SCD30();
+//Sans carte SD (ou si elle ne répond pas) le journal reste coupé, ses tâches ne sont pas lancées
+    if (Stockage != NULL && Stockage->init() == 0) {
+        Journal = new brew_log(*Stockage, 3);
+        if (Journal->Mount() != 0) {
+            delete Journal;
+            Journal = NULL;
+        }
+    }
+    if (Journal == NULL) {
+        pc.printf("Journal indisponible\n\r");
+    }
+
+    pc.printf("Kp = %f;Ki = %f;Kd = %f\n\r",Kp,Ki,Kd);
+    pc.attach(Reception_pc, SerialBase::RxIrq);
+
+//Chaque tâche à sa cadence, les échanges I2C du scd30 se font pendant que les autres tâches tournent
+    File_evenements.call_every(PERIODE_REGULATION_MS, Tache_regulation);
+    File_evenements.call_every(PERIODE_TELEMETRIE_MS, Tache_telemetrie);
+    if (Journal != NULL) {
+        File_evenements.call_every(PERIODE_JOURNAL_S * 1000, Tache_journal);
+        File_evenements.call_every(FLUSH_JOURNAL_S * 1000, Flush_journal);
+    }
+    File_evenements.dispatch_forever();
+    return 0;
+}
+
+//-------------------------------------------------------------------------------------------------------------
+//-------------------------------------------------------------------------------------------------------------
+
+void Init_SCD30(void)
+{
+//Redémarrage du capteur, les mesures reprennent DEMARRAGE_SCD30_MS plus tard sans bloquer les autres tâches
+    scd.stopSampling();
+    scd.softReset();
+    File_evenements.call_in(DEMARRAGE_SCD30_MS, Demarrage_SCD30);
+}
+
+void Demarrage_SCD30(void)
+{
+//Mesures en continu, livrées par le driver à chaque nouvelle mesure
+    scd.setMeasInterval(INTERVALLE_SCD30_S);
+    scd.startMeasurement(0);
+    scd.startSampling(INTERVALLE_SCD30_S, SCD30_mesure, RDY_SCD30);
+}
+
+void Tache_regulation(void)
+{
+//Une seule acquisition par période, utilisée pour le PID et la télémétrie
+    int ratio = PT100.ReadRTD();
+
+//Sonde en défaut : chauffe coupée dans cette période et la température sort de la télémétrie
+    if (PT100.Status() != MAX31865_STATUS_OK) {
+        Relais.Shutdown();
+        Temperature_valide = false;
+        if (!Sonde_en_defaut) {
+            Sonde_en_defaut = true;
+            Lien_pc.printf("Defaut sonde : %s (0x%02X), chauffe coupee\n\r", max31865::StatusName(PT100.Status()), PT100.FaultBits());
+        }
+        return;
+    }
+
+    Temperature_mesuree = Table_PT100.CentiDegrees(Filtre_PT100.Update(ratio)) * 0.01f;
+    Temperature_valide = true;
+    Sonde_en_defaut = false;//le PID, figé pendant le défaut, reprend là où il s'était arrêté
+
+//On définie la puissance de chauffe
+    Regulateur.SetSetpoint(Temperature_consigne);
+    Relais = Regulateur.Update(Temperature_mesuree);
+}
+
+void SCD30_mesure(scd30::Measurement mesure)
+{
+//Appelée par le driver à chaque nouvelle mesure (front RDY ou interrogation calée sur l'intervalle)
+    if (mesure.status != scd30::SCDnoERROR) {
+        Lien_pc.printf("SCD30 ERROR: %d\n\r", mesure.status);
+        return;
+    }
+    CO2_mesure = mesure.co2;
+    Humidite_mesuree = mesure.hum;
+    CO2_valide = true;
+
+//Même reprise que C02main.cpp si le capteur décroche
+    if ((int)CO2_mesure > 10000) {
+        Init_SCD30();
+    }
+}
+
+void Tache_telemetrie(void)
+{
+//On regroupe toutes les voies valides dans une seule trame
+    telemetryFrame trame;
+    trame.seq = Numero_trame++;
+    trame.timestamp = timer.read_ms();//seuls les 16 bits de poids faible partent
+    trame.count = 0;
+    if (Temperature_valide) {
+        trame.channel[trame.count].type = TELEMETRY_TEMPERATURE;
+        trame.channel[trame.count++].value = (int32_t)(Temperature_mesuree * TELEMETRY_SCALE);
+    }
+    if (CO2_valide) {
+        trame.channel[trame.count].type = TELEMETRY_CO2;
+        trame.channel[trame.count++].value = (int32_t)(CO2_mesure * TELEMETRY_SCALE);
+        trame.channel[trame.count].type = TELEMETRY_HUMIDITE;
+        trame.channel[trame.count++].value = (int32_t)(Humidite_mesuree * TELEMETRY_SCALE);
+    }
+
+    uint8_t octets[TELEMETRY_MAX_FRAME_SIZE];
+    int taille = telemetryEncode(trame, octets, sizeof(octets));
+    if (taille > 0) {
+        Lien_Mbed.write(octets, taille);
+    }
+}
+
+void Tache_journal(void)
+{
+//Un échantillon compressé (delta) dans le journal, mêmes unités que la télémétrie
+    brew_sample echantillon;
+    echantillon.time = (uint32_t)(timer.read_high_resolution_us() / 1000000);//read_ms() déborde après 24,8 jours
+    echantillon.value[0] = (int32_t)(Temperature_mesuree * TELEMETRY_SCALE);
+    echantillon.value[1] = (int32_t)(CO2_mesure * TELEMETRY_SCALE);
+    echantillon.value[2] = (int32_t)(Humidite_mesuree * TELEMETRY_SCALE);
+    echantillon.value[3] = 0;
+    Journal->Append(echantillon);
+}
+
+void Flush_journal(void)
+{
+    Journal->Flush();
+}
+
+void Reception_pc(void)
+{
+//Interruption de réception : on ne fait que lire le caractère, l'affichage se fait dans la file
+    if (pc.getc() == COMMANDE_STATS) {
+        File_evenements.call(Affiche_stats_bus, 0);
+    }
+}
+
+void Affiche_stats_bus(int bus)
+{
+//Une ligne par appel : nombre de transactions, max, codes de résultat (code:nombre) et histogramme log2 en us
+//La suivante part ESPACEMENT_STATS plus tard par le buffer d'envoi : les tâches n'attendent jamais le port série
+    char ligne[BUS_STATS_LINE_SIZE + 2];
+    int taille;
+    switch (bus) {
+        case 0:
+            taille = PT100.ReadStats().Print(ligne, BUS_STATS_LINE_SIZE, "spi lecture");
+            break;
+        case 1:
+            taille = PT100.WriteStats().Print(ligne, BUS_STATS_LINE_SIZE, "spi ecriture");
+            break;
+        default:
+            taille = scd.stats().Print(ligne, BUS_STATS_LINE_SIZE, "i2c scd30");
+            break;
+    }
+    ligne[taille++] = '\n';
+    ligne[taille++] = '\r';
+    Lien_pc.write((const uint8_t *)ligne, taille);
+
+    if (bus < 2) {
+        File_evenements.call_in(ESPACEMENT_STATS, Affiche_stats_bus, bus + 1);
+    }
+}
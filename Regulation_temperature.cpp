@@ -1,5 +1,14 @@
 #include "mbed.h"
 #include "max31865.h"
+#include "rtd_table.h"
+#include "telemetry.h"
+#include "serial_tx.h"
+#include "pid.h"
+#include "autotune.h"
+#include "filters.h"
+#include "profiler.h"
+#include "mash_profile.h"
+#include "relay_output.h"
 
 
 #define temperature       0x54
@@ -8,25 +17,63 @@
 #define CO2               0x43
 #define viscosite         0x56
 
+#define PERIODE_MS        1000  //période de la régulation (une mesure par période)
+#define COMMANDE_PROFIL   'p'   //caractère reçu sur pc : affiche les temps de chaque zone et la gigue de la période
+#define FENETRE_RELAIS_MS 5000  //fenêtre du relais : une impulsion par fenêtre, proportionnelle à la puissance
+#define MINIMUM_RELAIS_MS 500   //impulsion et coupure les plus courtes envoyées au relais (le reste est reporté)
+#define ESPACEMENT_PROFIL 250   //ms entre deux lignes du profil : une ligne part avant la suivante, le buffer d'envoi ne déborde pas
+
 
 //initialisation de l'I/O
-Serial pc(SERIAL_TX, SERIAL_RX);
-Serial Mbed(PB_6,PB_7);
+RawSerial pc(SERIAL_TX, SERIAL_RX);
+serial_tx Lien_pc(pc);//affichages pendant la régulation sous interruption, ils ne retardent pas la période
+RawSerial Mbed(PB_6,PB_7);
+serial_tx Lien_Mbed(Mbed);//envoi vers l'autre microcontrolleur sous interruption, putc ne bloque plus la boucle
 max31865 PT100(PB_5, PB_4, PB_3, PA_11); // MOSI, MISO, SCLK, CS - D11, D12, D13, D10
-PwmOut PwmRelay(PA_8);//pinout relay PWM  /!\ le relay est normalement ouvert -> PwmRelay = 1 -> circuit fermé
 Timer timer;
+EventQueue File_evenements(16 * EVENTS_EVENT_SIZE);//cadence la régulation à période fixe
+relay_output Relais(PA_8, &File_evenements, FENETRE_RELAIS_MS, MINIMUM_RELAIS_MS, MINIMUM_RELAIS_MS);//pinout relay  /!\ le relay est normalement ouvert -> Relais = 1 -> circuit fermé
+median_filter<int, 3> Filtre_PT100;//médiane sur 3 mesures : une lecture parasitée (commutation du relais) ne passe pas dans le PID
+constexpr rtd_table<> Table_PT100(430.0, 100.0); //Table code RTD -> température calculée à la compilation (Resistance_referfance = 430, R0 = 100)
 
 
 // Déclaration des variables
-float Kp = 0.01, Ki = 0, Kd = 0,Temperature_consigne = 40, temps_1, temps_2, erreur_1, erreur_2, I, D;
+float Kp = 0.01, Ki = 0, Kd = 0, Tf = 0,Temperature_consigne = 40;
+pid<float> Regulateur(Kp, Ki, Kd, PERIODE_MS / 1000.0f, Tf);//sortie bornée entre 0 et 1 pour le Relais, pid<q16_16> pour un micro sans FPU
+bool Autoreglage = false;//true : essai en relais autour de la consigne pour calculer Kp/Ki/Kd avant de réguler
+autotune_rule_t Regle_autoreglage = AUTOTUNE_TYREUS_LUYBEN;//peu de dépassement, adapté à une cuve
+relay_autotune Essai_relais(1, 0, 0.2, 4);//sortie 1/0, hystérésis 0.2 °C, 4 oscillations mesurées
+bool Profil_brassage = false;//true : la consigne suit les paliers du brassin, avec anticipation de la puissance
+const mash_step Paliers[] = {//température (°C), rampe (°C/min, 0 = au plus vite), durée du palier (min)
+    {52, 0, 15},//protéines
+    {63, 0, 45},//bêta-amylase
+    {72, 0, 20},//alpha-amylase
+    {78, 0, 10},//mash-out
+};
+const mash_plant Cuve = {20 * 4186 + 3000, 9, 1800, 20, 30};//20 L d'eau sur plaque 1,8 kW : capacité (J/K), pertes (W/K), puissance (W), air (°C), retard plaque + sonde (s) ; identification dans le README
+mash_profile Brassin(Paliers, sizeof(Paliers) / sizeof(Paliers[0]), Cuve);
+uint8_t Numero_trame = 0;
+bool Sonde_en_defaut = false;//true tant que le max31865 signale un défaut : chauffe coupée
+
+//Profil de la boucle : durée de chaque étape en cycles (min/moyenne/max + histogramme) et écart à PERIODE_MS
+profile_period Periode_regulation("periode", PERIODE_MS * 1000);
+profile_zone Zone_regulation("regulation");
+profile_zone Zone_mesure("mesure");
+profile_zone Zone_calcul("calcul");
+profile_zone Zone_relais("relais");
+profile_zone Zone_envoi("envoi");
 
 
 // Déclaration des fonctions
 float Temperature(void);
-float Puissance_chauffe(void);
-float Deriver(float temps_1, float temps_2, float erreur_1, float erreur_2);
-float Integrale(float temps_1, float temps_2, float erreur_1, float S);
+float Puissance_chauffe(float Temperature_mesuree);
+float Puissance_autoreglage(float Temperature_mesuree);
+void Regulation(void);
+void Defaut_sonde(void);
+void Reception_pc(void);
+void Affiche_profil(profile_zone *zone);
 void Envoie_Donners(char type, float donner);// les donner sont le nombre a envoyé, il sera envoyé comme ça --,-
+void Envoie_Trame(float Temperature_mesuree);// trame binaire (telemetry.h) : toutes les voies en une fois, au 0,01 près
 
 
 //-------------------------------------------------------------------------------------------------------------
@@ -37,37 +84,111 @@ int main(void)
 {
 //Mise en place des paramètres non changent
     PT100.Begin(MAX31865_3WIRE);
-    PwmRelay.period(1);
+//Begin() lance la première conversion, la première mesure (départ du profil) attend qu'elle soit finie
+    wait_us(MAX31865_CONVERSION_US);
+    Relais.Start();
     timer.start();
 //On affiche nos coef pour les tests de paliers
     pc.printf("Kp = %f;Ki = %f;Kd = %f\n\r",Kp,Ki,Kd);
+    pc.attach(Reception_pc, SerialBase::RxIrq);
 
-    while(1) {
-        
-//On définie la puissance de chauffe
-        PwmRelay = Puissance_chauffe();
+//En mode autoréglage on commence par l'essai en relais, le PID prend la suite avec les coefficients trouvés
+    if (Autoreglage) {
+        Essai_relais.Start(Temperature_consigne, timer.read());
+    }
 
-//On récupère un premier couple Température/temps pour les calcules de dériver|Intégrale
-        erreur_2 = Temperature_consigne - Temperature();
-        temps_2 = timer.read();
+//Le profil de brassage part de la température de la cuve
+    if (Profil_brassage) {
+        Brassin.Start(Temperature(), timer.read());
+    }
+
+//On lance la régulation à période fixe : la file d'évènements rattrape le temps de calcul, la période ne dérive pas
+    File_evenements.call_every(PERIODE_MS, Regulation);
+    File_evenements.dispatch_forever();
+    return 0;
+}
 
-//On calcule la dériver/intégrale
-        D = Deriver(temps_1, temps_2, erreur_1, erreur_2);
-        I = Integrale(temps_1, temps_2, erreur_1, I);
+//-------------------------------------------------------------------------------------------------------------
+//-------------------------------------------------------------------------------------------------------------
+
+void Regulation(void)
+{
+    Periode_regulation.Tick();
+    PROFILE_SCOPE(Zone_regulation);
+
+//Une seule acquisition par période, utilisée pour le PID, la puissance et l'envoi
+    float Temperature_mesuree;
+    {
+        PROFILE_SCOPE(Zone_mesure);
+        Temperature_mesuree = Temperature();
+    }
+
+//Sonde ouverte, en court-circuit... : chauffe coupée dans cette période, le PID ne suit pas une mesure fausse
+    if (PT100.Status() != MAX31865_STATUS_OK) {
+        Defaut_sonde();
+        return;
+    }
+    if (Sonde_en_defaut) {
+//Retour de la sonde : le PID, figé pendant le défaut, reprend là où il s'était arrêté
+        Sonde_en_defaut = false;
+        Lien_pc.printf("Sonde OK : %.2f C\n\r", Temperature_mesuree);
+    }
+
+//On définie la puissance de chauffe
+    float Puissance;
+    {
+        PROFILE_SCOPE(Zone_calcul);
+        if (Autoreglage) {
+            Puissance = Puissance_autoreglage(Temperature_mesuree);
+        } else {
+            Puissance = Puissance_chauffe(Temperature_mesuree);
+        }
+    }
+    {
+        PROFILE_SCOPE(Zone_relais);
+        Relais = Puissance;
+    }
 
 //On fait les affichages (Temperature_consigne, Temperature_mesurée, Puissance_chauffe, temps, Dériver et Intégrale)
-       // pc.printf("Temperature_consigne = %.2f;Temperature_mesuree = %.2f;On chauffe a %.2f;temps(s) = %.2f;Erreur = %.2f;Deriver = %.2f;Integrale = %.2f\n\r",Temperature_consigne,(-1.0*erreur_1 + Temperature_consigne),PwmRelay.read()*100,temps_1,erreur_1,D,I);
+   // pc.printf("Temperature_consigne = %.2f;Temperature_mesuree = %.2f;On chauffe a %.2f;temps(s) = %.2f;Deriver = %.2f;Integrale = %.2f\n\r",Temperature_consigne,Temperature_mesuree,Relais.read()*100,timer.read(),Regulateur.Derivative(),Regulateur.Integral());
 
-//On gère les tempsattend une secondes entre nos prises de mesures
-        thread_sleep_for(1*1000);
+    PROFILE_SCOPE(Zone_envoi);
+    Envoie_Trame(Temperature_mesuree);
+}
 
-//On récupère un second couple Température/temps pour les calcules de dériver|Intégrale
-        temps_1 = temps_2;
-        erreur_1 = erreur_2;
+void Defaut_sonde(void)
+{
+//Sortie en sécurité : relais ouvert, pas de trame (la température n'est pas valide), un seul message par défaut
+    Relais.Shutdown();
+    if (!Sonde_en_defaut) {
+        Sonde_en_defaut = true;
+        Lien_pc.printf("Defaut sonde : %s (0x%02X), chauffe coupee\n\r", max31865::StatusName(PT100.Status()), PT100.FaultBits());
+    }
+}
 
-        
-        Envoie_Donners(temperature, Temperature());
-        
+void Reception_pc(void)
+{
+//Interruption de réception : on ne fait que lire le caractère, l'affichage se fait dans la file entre deux périodes
+    if (pc.getc() == COMMANDE_PROFIL) {
+        File_evenements.call(Affiche_profil, profile_zone::First());
+    }
+}
+
+void Affiche_profil(profile_zone *zone)
+{
+//Une zone par appel (temps en us, histogramme log2 en cycles), la suivante ESPACEMENT_PROFIL plus tard
+//Les lignes sont copiées dans le buffer d'envoi : la régulation n'attend jamais le port série
+    char ligne[PROFILER_LINE_SIZE];
+    int taille = zone->Print(ligne, sizeof(ligne) - 2);
+    ligne[taille++] = '\n';
+    ligne[taille++] = '\r';
+    Lien_pc.write((const uint8_t *)ligne, taille);
+
+    if (zone->Next() != NULL) {
+        File_evenements.call_in(ESPACEMENT_PROFIL, Affiche_profil, zone->Next());
+    } else {
+        Lien_pc.printf("gigue periode : avance max = %.1f us;retard max = %.1f us\n\r",
+                       profile_zone::Microseconds(-Periode_regulation.Early()), profile_zone::Microseconds(Periode_regulation.Late()));
     }
 }
 
@@ -77,46 +198,54 @@ int main(void)
 float Temperature(void)
 {
 //On récupère la température depuis la lecture de la différence de résistance des cables de la Pt100
-    float ratio, Resistance_mesuree, Temperature_mesuree, Resistance_referfance = 430.0;
-    
 //Le conditionneur retourne la valeur binaire non signée du ratio entre la Resistance_mesuree et Resistance_referfance
-//On a donc ratio = Resistance_mesuree / Resistance_referfance
-//On récupere la ratio
-    ratio = PT100.ReadRTD(); 
-    
-//L'information est envoye par le conditionneur sur les MSB on les remet donc sur les LSB pour les traiter
-    ratio /= 32768;
-    
-//On calcule Resistance_mesuree a partire du ratio
-    Resistance_mesuree = Resistance_referfance*ratio;
-    
-//On calcule la temperature grace a la loi d'etalonnage qu'on a etablie : R = 0.365T + 100
-    Temperature_mesuree = ((Resistance_mesuree - 100)/0.365); 
+//On récupere la ratio (code sur 15 bits)
+    int ratio = PT100.ReadRTD();
+
+//En défaut (bit de défaut du code RTD) la mesure ne passe pas dans la médiane, Regulation() coupe la chauffe
+    if (PT100.Status() != MAX31865_STATUS_OK) {
+        return 0;
+    }
+    ratio = Filtre_PT100.Update(ratio);
     
-    return Temperature_mesuree;
+//La table donne la température en centièmes de degré suivant la loi de Callendar-Van Dusen, uniquement en calcul entier
+    return Table_PT100.CentiDegrees(ratio) * 0.01f;
 }
 
-float Puissance_chauffe(void)
+float Puissance_chauffe(float Temperature_mesuree)
 {
 //On calcule la puissance d'allimentation de la plaque chauffante
-    float erreur = Temperature_consigne - Temperature();
-    if (erreur < 0 ) {
-        return 0;
-    } else {
-        return erreur*Kp + Ki*I + Kd*D;
+//Le PID borne la sortie entre 0 (au dessus de la consigne on ne chauffe pas) et 1
+    if (!Profil_brassage) {
+        Regulateur.SetSetpoint(Temperature_consigne);
+        return Regulateur.Update(Temperature_mesuree);
     }
-}
 
-float Deriver(float temps_1, float temps_2, float erreur_1, float erreur_2)
-{
-//On dérive l'erreur
-    return (erreur_2-erreur_1)/(temps_2-temps_1);
+//Avec le profil, la consigne avance en rampe et on anticipe la puissance qu'il faut pour la suivre (bilan thermique de la cuve)
+//Le PID ne corrige que l'écart au modèle, ses bornes sont décalées pour que la somme reste entre 0 et 1
+    Temperature_consigne = Brassin.Update(Temperature_mesuree, timer.read());
+    float Anticipation = Brassin.Feedforward();
+    Regulateur.SetLimits(-Anticipation, 1 - Anticipation);
+    Regulateur.SetTrajectory(Temperature_consigne);
+    return Anticipation + Regulateur.Update(Temperature_mesuree);
 }
 
-float Integrale(float temps_1, float temps_2, float erreur_1, float S)
+float Puissance_autoreglage(float Temperature_mesuree)
 {
-//On intègre l'erreur
-    return (temps_2-temps_1)*erreur_1 + 0*S;
+//Essai en relais : tout ou rien autour de la consigne, on mesure la période et l'amplitude des oscillations
+    float Puissance = Essai_relais.Update(Temperature_mesuree, timer.read());
+    if (!Essai_relais.Done()) {
+        return Puissance;
+    }
+
+//Essai terminé : on calcule les coefficients et on passe en régulation PID sans à-coup
+    Essai_relais.Gains(Regle_autoreglage, Kp, Ki, Kd);
+    Lien_pc.printf("Autoreglage : Ku = %f;Pu = %f s;Kp = %f;Ki = %f;Kd = %f\n\r",Essai_relais.Ku(),Essai_relais.Pu(),Kp,Ki,Kd);
+    Regulateur.SetGains(Kp, Ki, Kd);
+    Regulateur.SetSetpoint(Temperature_consigne);
+    Regulateur.Reset(Temperature_mesuree, Puissance);
+    Autoreglage = false;
+    return Puissance;
 }
 
 void Envoie_Donners(char type, float donner)
@@ -127,10 +256,28 @@ void Envoie_Donners(char type, float donner)
     int c2 = int(donner) % 10;
     int c1 = int(donner) / 10;
 //On envoie notre trame 
-    Mbed.putc(0xAA);
-    Mbed.putc(type);
-    Mbed.putc(c1+0x30);
-    Mbed.putc(c2+0x30);
-    Mbed.putc(c3+0x30);
-    Mbed.putc(0xF0);
+    Lien_Mbed.enqueue(0xAA);
+    Lien_Mbed.enqueue(type);
+    Lien_Mbed.enqueue(c1+0x30);
+    Lien_Mbed.enqueue(c2+0x30);
+    Lien_Mbed.enqueue(c3+0x30);
+    Lien_Mbed.enqueue(0xF0);
+}
+
+void Envoie_Trame(float Temperature_mesuree)
+{
+//On remplit la trame : numéro, temps en ms et une voie par mesure (valeur * TELEMETRY_SCALE)
+    telemetryFrame trame;
+    trame.seq = Numero_trame++;
+    trame.timestamp = timer.read_ms();//seuls les 16 bits de poids faible partent
+    trame.count = 1;
+    trame.channel[0].type = TELEMETRY_TEMPERATURE;
+    trame.channel[0].value = (int32_t)(Temperature_mesuree * TELEMETRY_SCALE);
+    
+//On envoie notre trame d'un seul coup (copiée dans le buffer d'envoi, l'interruption fait le reste)
+    uint8_t octets[TELEMETRY_MAX_FRAME_SIZE];
+    int taille = telemetryEncode(trame, octets, sizeof(octets));
+    if (taille > 0) {
+        Lien_Mbed.write(octets, taille);
+    }
 }
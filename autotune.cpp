@@ -0,0 +1,105 @@
+#include "autotune.h"
+
+relay_autotune::relay_autotune(float high, float low, float hysteresis, int cycles)
+{
+    this->high = high;
+    this->low = low;
+    this->hysteresis = hysteresis;
+    this->cycles = cycles;
+    setpoint = 0;
+    on = false;
+    done = false;
+    count = 0;
+    lastRise = 0;
+    peakMax = peakMin = 0;
+    sumPeriod = sumAmplitude = 0;
+}
+
+void relay_autotune::Start(float setpoint, float t)
+{
+    this->setpoint = setpoint;
+    on = false;
+    done = false;
+    count = 0;
+    lastRise = t;
+    peakMax = peakMin = setpoint;
+    sumPeriod = sumAmplitude = 0;
+}
+
+float relay_autotune::Update(float measurement, float t)
+{
+    if (done)
+    {
+        return low;
+    }
+
+    if (measurement > peakMax) peakMax = measurement;
+    if (measurement < peakMin) peakMin = measurement;
+
+    if (on && measurement > setpoint + hysteresis)
+    {
+        on = false;
+    }
+    else if (!on && measurement < setpoint - hysteresis)
+    {
+        // low -> high: one full cycle since the previous rise
+        on = true;
+        if (count >= 2)
+        {
+            sumPeriod += t - lastRise;
+            sumAmplitude += (peakMax - peakMin) / 2;
+        }
+        count++;
+        lastRise = t;
+        peakMax = peakMin = measurement;
+
+        if (count >= cycles + 2)
+        {
+            done = true;
+            return low;
+        }
+    }
+
+    return on ? high : low;
+}
+
+float relay_autotune::Pu() const
+{
+    int n = count - 2;
+    return n > 0 ? sumPeriod / n : 0;
+}
+
+float relay_autotune::Ku() const
+{
+    int n = count - 2;
+    if (n <= 0 || sumAmplitude <= 0)
+    {
+        return 0;
+    }
+    float a = sumAmplitude / n;
+    float d = (high - low) / 2;
+    return 4 * d / (3.14159265f * a);
+}
+
+void relay_autotune::Gains(autotune_rule_t rule, float &kp, float &ki, float &kd) const
+{
+    float ku = Ku();
+    float pu = Pu();
+    float ti, td;
+
+    if (rule == AUTOTUNE_TYREUS_LUYBEN)
+    {
+        kp = ku / 2.2f;
+        ti = 2.2f * pu;
+        td = pu / 6.3f;
+    }
+    else
+    {
+        kp = 0.6f * ku;
+        ti = 0.5f * pu;
+        td = 0.125f * pu;
+    }
+
+    ki = ti > 0 ? kp / ti : 0;
+    kd = kp * td;
+}
@@ -0,0 +1,48 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+// Relay feedback (Astrom-Hagglund) autotuning.
+//
+// The output switches between high and low around the setpoint (with a
+// hysteresis band) and the plant settles into a limit cycle. From its
+// period Pu and amplitude a, the ultimate gain is Ku = 4 d / (pi a) with
+// d = (high - low) / 2, and the PID gains follow from a tuning rule.
+//
+// Everything is measured on the fly: one running min/max per cycle and
+// running sums, no sample buffer.
+
+typedef enum autotune_rule {
+  AUTOTUNE_ZIEGLER_NICHOLS = 0,   // fast, ~25% overshoot
+  AUTOTUNE_TYREUS_LUYBEN = 1      // slower, little overshoot, suits thermal plants
+} autotune_rule_t;
+
+class relay_autotune {
+    public:
+
+    relay_autotune(float high = 1, float low = 0, float hysteresis = 0.2f, int cycles = 4);
+
+    // start an experiment around setpoint, t in seconds
+    void Start(float setpoint, float t);
+
+    // feed one sample, returns the relay output to apply
+    float Update(float measurement, float t);
+
+    bool Done() const { return done; }
+    float Ku() const;
+    float Pu() const;
+
+    // PID gains (ki = kp / Ti, kd = kp * Td) for a rule
+    void Gains(autotune_rule_t rule, float &kp, float &ki, float &kd) const;
+
+    private:
+    float high, low, hysteresis, setpoint;
+    int cycles;
+
+    bool on, done;
+    int count;              // rising switches seen, the first cycle is discarded
+    float lastRise;         // time of the last low -> high switch
+    float peakMax, peakMin; // extremes of the current cycle
+    float sumPeriod, sumAmplitude;
+};
+
+#endif
@@ -0,0 +1,328 @@
+#include "brew_log.h"
+#include "MbedCRC.h"
+
+#define BREW_LOG_MAX_BLOCKS             2048    // log area at the start of the device (1 MB)
+
+//-----------------------------------------------------------------------------
+// Helpers shared by the writer and the reader
+
+static uint32_t ZigZag(int32_t d)
+{
+    return ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+}
+
+static int32_t UnZigZag(uint32_t z)
+{
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+static uint32_t LogBlocks(BlockDevice &bd)
+{
+    uint64_t n = bd.size() / BREW_LOG_BLOCK_SIZE;
+    return n > BREW_LOG_MAX_BLOCKS ? BREW_LOG_MAX_BLOCKS : (uint32_t)n;
+}
+
+static uint32_t BlockCrc(uint8_t *buff)
+{
+    // CRC over the whole block with the CRC field itself at zero
+    uint8_t saved[2] = { buff[10], buff[11] };
+    buff[10] = buff[11] = 0;
+    MbedCRC<POLY_16BIT_CCITT, 16> ct;
+    uint32_t crc = 0;
+    ct.compute(buff, BREW_LOG_BLOCK_SIZE, &crc);
+    buff[10] = saved[0];
+    buff[11] = saved[1];
+    return crc & 0xFFFF;
+}
+
+// 1 = valid block, 0 = empty (no magic), -1 = corrupted
+static int CheckBlock(uint8_t *buff)
+{
+    if (((buff[0] << 8) | buff[1]) != BREW_LOG_MAGIC) return 0;
+    uint32_t crc = (buff[10] << 8) | buff[11];
+    if (BlockCrc(buff) != crc) return -1;
+    if (buff[8] == 0 || buff[8] > BREW_LOG_MAX_CHANNELS) return -1;
+    return 1;
+}
+
+static uint32_t BlockSequence(const uint8_t *buff)
+{
+    return ((uint32_t)buff[2] << 24) | ((uint32_t)buff[3] << 16) | (buff[4] << 8) | buff[5];
+}
+
+//-----------------------------------------------------------------------------
+// Writer
+
+brew_log::brew_log(BlockDevice &bd, int channels) : bd(bd)
+{
+    this->channels = channels > BREW_LOG_MAX_CHANNELS ? BREW_LOG_MAX_CHANNELS : channels;
+    blocks = 0;
+    next = 0;
+    sequence = 0;
+    samples = 0;
+    blocksWritten = 0;
+    StartBlock();
+}
+
+int brew_log::Mount()
+{
+    blocks = LogBlocks(bd);
+    next = 0;
+    sequence = 0;
+    if (blocks == 0) return BD_ERROR_DEVICE_ERROR;
+
+    // continue after the block with the highest sequence number
+    bool found = false;
+    for (uint32_t i = 0; i < blocks; i++)
+    {
+        int err = bd.read(buff, (bd_addr_t)i * BREW_LOG_BLOCK_SIZE, BREW_LOG_BLOCK_SIZE);
+        if (err)
+        {
+            blocks = 0;     // stays unmounted
+            StartBlock();
+            return err;
+        }
+        if (CheckBlock(buff) != 1) continue;
+        uint32_t seq = BlockSequence(buff);
+        if (!found || seq >= sequence)
+        {
+            found = true;
+            sequence = seq + 1;
+            next = (i + 1) % blocks;
+        }
+    }
+
+    StartBlock();
+    return 0;
+}
+
+int brew_log::Append(const brew_sample &s)
+{
+    // not mounted: a full block could not be sealed and the next bits would run past buff
+    if (blocks == 0) return BD_ERROR_DEVICE_ERROR;
+
+    // seal the block when a worst case sample might not fit
+    int worst = 36 + channels * 35;
+    if (count && bitPos + worst > BREW_LOG_BLOCK_SIZE * 8)
+    {
+        int err = SealBlock();
+        if (err) return err;
+    }
+
+    if (count == 0)
+    {
+        PutBits(s.time, 32);
+        for (int c = 0; c < channels; c++) PutBits(s.value[c], 32);
+        prevDelta = 0;
+    }
+    else
+    {
+        uint32_t delta = s.time - prevTime;
+        uint32_t z = ZigZag((int32_t)(delta - prevDelta));
+        if (z == 0)             PutBits(0x0, 1);
+        else if (z < (1 << 7))  { PutBits(0x2, 2); PutBits(z, 7); }
+        else if (z < (1 << 9))  { PutBits(0x6, 3); PutBits(z, 9); }
+        else if (z < (1 << 12)) { PutBits(0xE, 4); PutBits(z, 12); }
+        else                    { PutBits(0xF, 4); PutBits(z, 32); }
+        prevDelta = delta;
+
+        for (int c = 0; c < channels; c++)
+        {
+            z = ZigZag((int32_t)((uint32_t)s.value[c] - prevValue[c]));
+            if (z == 0)             PutBits(0x0, 1);
+            else if (z < (1 << 6))  { PutBits(0x2, 2); PutBits(z, 6); }
+            else if (z < (1 << 12)) { PutBits(0x6, 3); PutBits(z, 12); }
+            else                    { PutBits(0x7, 3); PutBits(z, 32); }
+        }
+    }
+
+    prevTime = s.time;
+    for (int c = 0; c < channels; c++) prevValue[c] = s.value[c];
+    count++;
+    samples++;
+    return 0;
+}
+
+int brew_log::Flush()
+{
+    return SealBlock();
+}
+
+void brew_log::StartBlock()
+{
+    memset(buff, 0, sizeof(buff));
+    bitPos = BREW_LOG_HEADER_SIZE * 8;
+    count = 0;
+}
+
+int brew_log::SealBlock()
+{
+    if (blocks == 0) return BD_ERROR_DEVICE_ERROR;
+    if (count == 0) return 0;
+
+    buff[0] = BREW_LOG_MAGIC >> 8;
+    buff[1] = BREW_LOG_MAGIC & 255;
+    buff[2] = sequence >> 24;
+    buff[3] = sequence >> 16;
+    buff[4] = sequence >> 8;
+    buff[5] = sequence & 255;
+    buff[6] = count >> 8;
+    buff[7] = count & 255;
+    buff[8] = channels;
+    buff[9] = 0;
+    uint32_t crc = BlockCrc(buff);
+    buff[10] = crc >> 8;
+    buff[11] = crc & 255;
+
+    // erase when entering a new erase unit, it only holds the oldest blocks
+    bd_addr_t addr = (bd_addr_t)next * BREW_LOG_BLOCK_SIZE;
+    bd_size_t eraseSize = bd.get_erase_size();
+    if (eraseSize < BREW_LOG_BLOCK_SIZE) eraseSize = BREW_LOG_BLOCK_SIZE;
+    if (addr % eraseSize == 0)
+    {
+        int err = bd.erase(addr, eraseSize);
+        if (err) return err;
+    }
+
+    int err = bd.program(buff, addr, BREW_LOG_BLOCK_SIZE);
+    if (err) return err;
+
+    next = (next + 1) % blocks;
+    sequence++;
+    blocksWritten++;
+    StartBlock();
+    return 0;
+}
+
+void brew_log::PutBits(uint32_t v, int n)
+{
+    while (n--)
+    {
+        if ((v >> n) & 1) buff[bitPos >> 3] |= 0x80 >> (bitPos & 7);
+        bitPos++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Reader
+
+brew_log_reader::brew_log_reader(BlockDevice &bd) : bd(bd)
+{
+    blocks = 0;
+    block = 0;
+    sequence = 0;
+    remaining = 0;
+    badBlocks = 0;
+    channels = 0;
+    count = index = 0;
+}
+
+int brew_log_reader::Open()
+{
+    blocks = LogBlocks(bd);
+    badBlocks = 0;
+    count = index = 0;
+    remaining = 0;
+
+    // start at the block with the lowest sequence number
+    bool found = false;
+    for (uint32_t i = 0; i < blocks; i++)
+    {
+        int err = bd.read(buff, (bd_addr_t)i * BREW_LOG_BLOCK_SIZE, BREW_LOG_BLOCK_SIZE);
+        if (err) return err;
+        if (CheckBlock(buff) != 1) continue;
+        uint32_t seq = BlockSequence(buff);
+        if (!found || seq < sequence)
+        {
+            found = true;
+            sequence = seq;
+            block = i;
+        }
+    }
+
+    if (found)
+    {
+        remaining = blocks;
+    }
+    return 0;
+}
+
+bool brew_log_reader::Next(brew_sample &s)
+{
+    while (index >= count)
+    {
+        if (remaining == 0) return false;
+        remaining--;
+        uint32_t i = block;
+        block = (block + 1) % blocks;
+        LoadBlock(i);
+    }
+
+    if (index == 0)
+    {
+        s.time = GetBits(32);
+        for (int c = 0; c < channels; c++) s.value[c] = GetBits(32);
+        prevDelta = 0;
+    }
+    else
+    {
+        uint32_t z;
+        if (!GetBits(1))        z = 0;
+        else if (!GetBits(1))   z = GetBits(7);
+        else if (!GetBits(1))   z = GetBits(9);
+        else if (!GetBits(1))   z = GetBits(12);
+        else                    z = GetBits(32);
+        prevDelta += UnZigZag(z);
+        s.time = prevTime + prevDelta;
+
+        for (int c = 0; c < channels; c++)
+        {
+            if (!GetBits(1))        z = 0;
+            else if (!GetBits(1))   z = GetBits(6);
+            else if (!GetBits(1))   z = GetBits(12);
+            else                    z = GetBits(32);
+            s.value[c] = (int32_t)(prevValue[c] + UnZigZag(z));
+        }
+    }
+    for (int c = channels; c < BREW_LOG_MAX_CHANNELS; c++) s.value[c] = 0;
+
+    prevTime = s.time;
+    for (int c = 0; c < channels; c++) prevValue[c] = s.value[c];
+    index++;
+    return true;
+}
+
+bool brew_log_reader::LoadBlock(uint32_t i)
+{
+    count = index = 0;
+    if (bd.read(buff, (bd_addr_t)i * BREW_LOG_BLOCK_SIZE, BREW_LOG_BLOCK_SIZE))
+    {
+        badBlocks++;
+        return false;
+    }
+
+    int state = CheckBlock(buff);
+    if (state < 0) badBlocks++;
+    if (state != 1) return false;
+
+    // blocks older than the one we started from belong to the end of the ring
+    uint32_t seq = BlockSequence(buff);
+    if (seq < sequence) return false;
+    sequence = seq;
+
+    channels = buff[8];
+    count = (buff[6] << 8) | buff[7];
+    bitPos = BREW_LOG_HEADER_SIZE * 8;
+    return true;
+}
+
+uint32_t brew_log_reader::GetBits(int n)
+{
+    uint32_t v = 0;
+    while (n--)
+    {
+        v = (v << 1) | ((buff[bitPos >> 3] >> (7 - (bitPos & 7))) & 1);
+        bitPos++;
+    }
+    return v;
+}
@@ -0,0 +1,108 @@
+#ifndef BREW_LOG_H
+#define BREW_LOG_H
+
+#include "mbed.h"
+#include "BlockDevice.h"
+
+// Append-only compressed log of brew samples on a BlockDevice
+// (SD card or flash on target, FileBlockDevice on Linux).
+//
+// The device is used as a ring of fixed size blocks. Each block is self
+// contained and written once, when it is full or on Flush():
+//
+//   magic (2) | sequence (4) | samples (2) | channels (1) | reserved (1) | crc16 (2) | bit stream
+//
+// First sample of a block: time and values raw (32 bits). Then time is
+// coded as delta-of-delta and each value as a zigzag delta, in variable
+// length buckets:
+//
+//   time dod:  0 | 10 + 7 bits | 110 + 9 bits | 1110 + 12 bits | 1111 + 32 bits
+//   value:     0 | 10 + 6 bits | 110 + 12 bits | 111 + 32 bits
+//
+// Regular samples of slowly moving values cost a few bits each. The CRC
+// (CCITT) covers the header and the bit stream; bad blocks are skipped by
+// the reader. The highest valid sequence number marks the end of the log.
+
+#define BREW_LOG_BLOCK_SIZE             512
+#define BREW_LOG_HEADER_SIZE            12
+#define BREW_LOG_MAX_CHANNELS           4
+#define BREW_LOG_MAGIC                  0x4252  // "BR"
+
+struct brew_sample {
+    uint32_t time;                              // seconds
+    int32_t value[BREW_LOG_MAX_CHANNELS];       // fixed point, e.g. TELEMETRY_SCALE
+};
+
+class brew_log {
+    public:
+
+    brew_log(BlockDevice &bd, int channels);
+
+    // find the end of an existing log (or start a new one), 0 or BlockDevice error
+    // (BD_ERROR_DEVICE_ERROR when the device holds less than one block)
+    int Mount();
+
+    // add one sample, programs a block when it is full;
+    // BD_ERROR_DEVICE_ERROR until Mount() succeeded
+    int Append(const brew_sample &s);
+
+    // write the current partial block now (next samples start a new block)
+    int Flush();
+
+    uint32_t Samples() const { return samples; }
+    uint32_t BlocksWritten() const { return blocksWritten; }
+
+    private:
+    BlockDevice &bd;
+    int channels;
+    uint32_t blocks;            // blocks on the device
+    uint32_t next;              // block index to program next
+    uint32_t sequence;
+    uint32_t samples;
+    uint32_t blocksWritten;
+
+    uint8_t buff[BREW_LOG_BLOCK_SIZE];
+    int bitPos;
+    uint16_t count;
+    uint32_t prevTime, prevDelta;
+    uint32_t prevValue[BREW_LOG_MAX_CHANNELS];
+
+    void StartBlock();
+    int SealBlock();
+    void PutBits(uint32_t v, int n);
+};
+
+class brew_log_reader {
+    public:
+
+    brew_log_reader(BlockDevice &bd);
+
+    // locate the oldest block, 0 or BlockDevice error
+    int Open();
+
+    // next sample in time order, false at the end of the log
+    bool Next(brew_sample &s);
+
+    int Channels() const { return channels; }
+    uint32_t BadBlocks() const { return badBlocks; }
+
+    private:
+    BlockDevice &bd;
+    uint32_t blocks;
+    uint32_t block;             // block being decoded
+    uint32_t sequence;          // its sequence number
+    uint32_t remaining;         // blocks left to visit
+    uint32_t badBlocks;
+    int channels;
+
+    uint8_t buff[BREW_LOG_BLOCK_SIZE];
+    int bitPos;
+    uint16_t count, index;
+    uint32_t prevTime, prevDelta;
+    uint32_t prevValue[BREW_LOG_MAX_CHANNELS];
+
+    bool LoadBlock(uint32_t i);
+    uint32_t GetBits(int n);
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include "bus_record.h"
+
+//-----------------------------------------------------------------------------
+// Recording file
+
+bus_recorder::bus_recorder(FILE *file) : _file(file)
+{
+    _last = 0;
+    _records = 0;
+    _bytes = 0;
+    _i2c = NULL;
+    for (int i = 0; i < 4; i++) {
+        put(BUS_RECORD_MAGIC[i]);
+    }
+    put(BUS_RECORD_VERSION);
+    _timer.start();
+}
+
+void bus_recorder::record(uint8_t bus, uint8_t kind, uint8_t address, int result,
+                          const char *tx, int txLen, const char *rx, int rxLen, uint64_t time)
+{
+    // an async transfer is written after the transactions that ran while it
+    // was pending: keep the file in time order, dt is never negative
+    if (time < _last) {
+        time = _last;
+    }
+    put((bus << 4) | (kind & 15));
+    putVarint((uint32_t)(time - _last));
+    _last = time;
+    put(address);
+    put((uint8_t)result);
+    putVarint(txLen);
+    for (int i = 0; i < txLen; i++) {
+        put(tx[i]);
+    }
+    putVarint(rxLen);
+    for (int i = 0; i < rxLen; i++) {
+        put(rx[i]);
+    }
+    _records++;
+}
+
+int bus_recorder::flush()
+{
+    // an async transfer completed since the last call would otherwise be lost
+    for (i2c_recorder *r = _i2c; r; r = r->_next) {
+        r->flush();
+    }
+    return fflush(_file);
+}
+
+void bus_recorder::put(uint8_t c)
+{
+    if (_file) {
+        fputc(c, _file);
+    }
+    _bytes++;
+}
+
+void bus_recorder::putVarint(uint32_t v)
+{
+    // 7 bits per byte, high bit set when more bytes follow
+    while (v >= 0x80) {
+        put((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    put(v);
+}
+
+//-----------------------------------------------------------------------------
+// SPI
+
+spi_recorder::spi_recorder(spi_transport &bus, bus_recorder &rec, uint8_t id) : _bus(bus), _rec(rec), _id(id)
+{
+}
+
+int spi_recorder::transfer(const char *tx, int txLen, char *rx, int rxLen)
+{
+    uint64_t t = _rec.now();
+    int n = _bus.transfer(tx, txLen, rx, rxLen);
+    _rec.record(_id, BUSspi, 0, 0, tx, txLen, rx, rx ? rxLen : 0, t);
+    return n;
+}
+
+//-----------------------------------------------------------------------------
+// I2C
+
+i2c_recorder::i2c_recorder(i2c_transport &bus, bus_recorder &rec, uint8_t id) : _bus(bus), _rec(rec), _id(id)
+{
+#if DEVICE_I2C_ASYNCH
+    _pending = false;
+    _done = false;
+#endif
+    _next = rec._i2c;
+    rec._i2c = this;
+}
+
+i2c_recorder::~i2c_recorder()
+{
+    flush();
+    for (i2c_recorder **r = &_rec._i2c; *r; r = &(*r)->_next) {
+        if (*r == this) {
+            *r = _next;
+            break;
+        }
+    }
+}
+
+int i2c_recorder::write(int address, const char *data, int length, bool repeated)
+{
+    flush();
+    uint64_t t = _rec.now();
+    int res = _bus.write(address, data, length, repeated);
+    _rec.record(_id, BUSi2cWrite, address, res, data, length, NULL, 0, t);
+    return res;
+}
+
+int i2c_recorder::read(int address, char *data, int length, bool repeated)
+{
+    flush();
+    uint64_t t = _rec.now();
+    int res = _bus.read(address, data, length, repeated);
+    _rec.record(_id, BUSi2cRead, address, res, NULL, 0, data, length, t);
+    return res;
+}
+
+void i2c_recorder::flush()
+{
+#if DEVICE_I2C_ASYNCH
+    if (!_pending || !_done) {
+        return;
+    }
+    // same records as the blocking calls, the replayer does not see the difference
+    int res = _event & (I2C_EVENT_ERROR | I2C_EVENT_ERROR_NO_SLAVE | I2C_EVENT_TRANSFER_EARLY_NACK) ? 1 : 0;
+    if (_txLen) {
+        _rec.record(_id, BUSi2cWrite, _address, res, _tx, _txLen, NULL, 0, _time);
+    }
+    if (_rxLen) {
+        _rec.record(_id, BUSi2cRead, _address, res, NULL, 0, _rx, _rxLen, _time);
+    }
+    _pending = false;
+#endif
+}
+
+#if DEVICE_I2C_ASYNCH
+int i2c_recorder::transfer(int address, const char *tx, int txLen, char *rx, int rxLen,
+                           const event_callback_t &cb, int event, bool repeated)
+{
+    flush();
+    if (_pending || txLen > BUS_RECORD_MAX_BYTES || rxLen > BUS_RECORD_MAX_BYTES) {
+        return -1;
+    }
+    _address = address;
+    memcpy(_tx, tx, txLen);
+    _txLen = txLen;
+    _rxUser = rx;
+    _rxLen = rxLen;
+    _cb = cb;
+    _done = false;
+    _pending = true;
+    _time = _rec.now();     // start of the transfer, as the blocking calls are stamped
+    int res = _bus.transfer(address, tx, txLen, rx, rxLen, callback(this, &i2c_recorder::transferDone), event, repeated);
+    if (res) {
+        _pending = false;
+    }
+    return res;
+}
+
+void i2c_recorder::transferDone(int event)
+{
+    // interrupt: only copy, the file is written later
+    _event = event;
+    if (_rxLen) {
+        memcpy(_rx, _rxUser, _rxLen);
+    }
+    _done = true;
+    if (_cb) {
+        _cb(event);
+    }
+}
+#endif
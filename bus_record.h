@@ -0,0 +1,157 @@
+#ifndef BUS_RECORD_H
+#define BUS_RECORD_H
+
+#include "mbed.h"
+#include "bus_transport.h"
+
+// Recorder for bus transactions, to capture a brew once and replay it on
+// Linux (sim/bus_replay.h) against the same drivers and control code.
+//
+// Recording file: "BUSR" | version, then one record per transaction
+//
+//   tag (bus << 4 | kind) | dt (varint, us since the previous record) | address | result |
+//   txLen (varint) | tx bytes | rxLen (varint) | rx bytes
+//
+// Usage, any transport can be wrapped:
+//
+//   FILE *f = fopen("/sd/brassin.bus", "wb");
+//   bus_recorder rec(f);
+//   mbed_spi_transport spi(PB_5, PB_4, PB_3, PA_11, 1, 500000);
+//   spi_recorder spiRec(spi, rec, 0);
+//   max31865 PT100(spiRec);
+
+#define BUS_RECORD_MAGIC                "BUSR"
+#define BUS_RECORD_VERSION              1
+#define BUS_RECORD_MAX_BYTES            64      //longest transaction kept by the async I2C recorder
+
+enum BUSkind {
+    BUSspi       = 1,   //SPI transaction (one chip select)
+    BUSi2cWrite  = 2,   //I2C write
+    BUSi2cRead   = 3,   //I2C read
+};
+
+class i2c_recorder;
+
+    /** Append transactions to a recording file
+     *
+     */
+class bus_recorder {
+
+public:
+    /** Start a recording, writes the file header
+     *
+     * @param file open for writing (binary)
+     *
+     * @return none
+     */
+    bus_recorder(FILE *file);
+
+    /** Add one transaction
+     *
+     * @param bus id (0..15)
+     * @param enum BUSkind
+     * @param I2C address (0 for SPI)
+     * @param transport return value
+     * @param sent bytes and count
+     * @param received bytes and count
+     * @param time of the transaction in us, from now()
+     *
+     * @return none
+     */
+    void record(uint8_t bus, uint8_t kind, uint8_t address, int result,
+                const char *tx, int txLen, const char *rx, int rxLen, uint64_t time);
+
+    /** Time base of the recording in us, callable from interrupts */
+    uint64_t now() { return _timer.read_high_resolution_us(); }
+
+    /** Push buffered records to the file, completed async I2C transfers included
+     *
+     * @return 0 or stdio error
+     */
+    int flush();
+
+    uint32_t records() const { return _records; }
+    uint32_t bytes() const { return _bytes; }
+
+private:
+    FILE *_file;
+    Timer _timer;
+    uint64_t _last;
+    uint32_t _records;
+    uint32_t _bytes;
+    i2c_recorder *_i2c;     // recorders holding async transfers, flushed with the file
+
+    friend class i2c_recorder;
+    void put(uint8_t c);
+    void putVarint(uint32_t v);
+};
+
+    /** SPI transport that records everything passing through
+     *
+     */
+class spi_recorder : public spi_transport {
+
+public:
+    spi_recorder(spi_transport &bus, bus_recorder &rec, uint8_t id);
+
+    virtual int transfer(const char *tx, int txLen, char *rx, int rxLen);
+
+private:
+    spi_transport &_bus;
+    bus_recorder &_rec;
+    uint8_t _id;
+};
+
+    /** I2C transport that records everything passing through
+     *
+     * Async transfers are copied when they complete (interrupt) and written
+     * to the file on the next call, on flush() or bus_recorder::flush(), never
+     * from the interrupt.
+     * One async transfer at a time, as scd30 does.
+     *
+     */
+class i2c_recorder : public i2c_transport {
+
+public:
+    i2c_recorder(i2c_transport &bus, bus_recorder &rec, uint8_t id);
+    ~i2c_recorder();
+
+    virtual int write(int address, const char *data, int length, bool repeated = false);
+    virtual int read(int address, char *data, int length, bool repeated = false);
+#if DEVICE_I2C_ASYNCH
+    virtual int transfer(int address, const char *tx, int txLen, char *rx, int rxLen,
+                         const event_callback_t &cb, int event, bool repeated);
+#endif
+
+    /** Write a completed async transfer to the recording
+     *
+     * @return none
+     */
+    void flush();
+
+private:
+    i2c_transport &_bus;
+    bus_recorder &_rec;
+    uint8_t _id;
+    i2c_recorder *_next;    // list of bus_recorder
+
+    friend class bus_recorder;
+
+#if DEVICE_I2C_ASYNCH
+    volatile bool _pending;
+    volatile bool _done;
+    int _address;
+    int _event;
+    uint64_t _time;
+    char _tx[BUS_RECORD_MAX_BYTES];
+    int _txLen;
+    char *_rxUser;
+    char _rx[BUS_RECORD_MAX_BYTES];
+    int _rxLen;
+    event_callback_t _cb;
+
+    void transferDone(int event);
+#endif
+};
+
+#endif
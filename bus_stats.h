@@ -0,0 +1,108 @@
+#ifndef BUS_STATS_H
+#define BUS_STATS_H
+
+#include "mbed.h"
+#include "cycle_counter.h"
+
+// Per-path bus instrumentation: transaction count, count per result code
+// and a log2 latency histogram.
+//
+// Build with -DBUS_STATS=0 to remove it: the class becomes empty and every
+// call compiles to nothing.
+
+#ifndef BUS_STATS
+#define BUS_STATS                       1
+#endif
+
+#define BUS_STATS_BUCKETS               16      //bucket 0: < 1 us, bucket i: 2^(i-1) .. 2^i us, last: longer
+#define BUS_STATS_RESULTS               16      //result codes counted (driver enum, 0 = ok)
+#define BUS_STATS_LINE_SIZE             160     //enough for Print()
+
+#if BUS_STATS
+
+class bus_stats {
+    public:
+
+    bus_stats() { cycle_counter::Init(); Reset(); }
+
+    // timestamp to pass to Stop()
+    uint32_t Start() const { return cycle_counter::Now(); }
+
+    // one transaction done, latency since Start()
+    void Stop(uint32_t start, uint8_t result) { Record(cycle_counter::Now() - start, result); }
+
+    // one transaction of known duration (ticks of cycle_counter)
+    void Record(uint32_t ticks, uint8_t result)
+    {
+        uint32_t us = ticks / (cycle_counter::Frequency() / 1000000);   // 32 bit divide, hardware on Cortex-M3 and up
+        int bucket = us ? 32 - __builtin_clz(us) : 0;
+        if (bucket >= BUS_STATS_BUCKETS) bucket = BUS_STATS_BUCKETS - 1;
+        histogram[bucket]++;
+        if (us > maxUs) maxUs = us;
+        count++;
+        Result(result);
+    }
+
+    // a result without latency (e.g. CRC checked after the transfer)
+    void Result(uint8_t result)
+    {
+        results[result < BUS_STATS_RESULTS ? result : BUS_STATS_RESULTS - 1]++;
+    }
+
+    void Reset()
+    {
+        count = 0;
+        maxUs = 0;
+        memset(histogram, 0, sizeof(histogram));
+        memset(results, 0, sizeof(results));
+    }
+
+    uint32_t Count() const { return count; }
+    uint32_t MaxUs() const { return maxUs; }
+    uint32_t Results(uint8_t result) const { return results[result]; }
+    uint32_t Bucket(int i) const { return histogram[i]; }
+
+    // one line: name n=count max=us r=code:count,... h=bucket counts (trailing zeros cut)
+    int Print(char *buff, int size, const char *name) const
+    {
+        int n = snprintf(buff, size, "%s n=%lu max=%luus r=", name, (unsigned long)count, (unsigned long)maxUs);
+        for (int i = 0; i < BUS_STATS_RESULTS && n < size; i++)
+        {
+            if (results[i]) n += snprintf(buff + n, size - n, "%d:%lu,", i, (unsigned long)results[i]);
+        }
+        int last = BUS_STATS_BUCKETS - 1;
+        while (last > 0 && histogram[last] == 0) last--;
+        if (n < size) n += snprintf(buff + n, size - n, " h=");
+        for (int i = 0; i <= last && n < size; i++)
+        {
+            n += snprintf(buff + n, size - n, i < last ? "%lu," : "%lu", (unsigned long)histogram[i]);
+        }
+        return n < size ? n : size - 1;
+    }
+
+    private:
+    uint32_t count;
+    uint32_t maxUs;
+    uint32_t histogram[BUS_STATS_BUCKETS];
+    uint32_t results[BUS_STATS_RESULTS];
+};
+
+#else
+
+class bus_stats {
+    public:
+    uint32_t Start() const { return 0; }
+    void Stop(uint32_t start, uint8_t result) {}
+    void Record(uint32_t ticks, uint8_t result) {}
+    void Result(uint8_t result) {}
+    void Reset() {}
+    uint32_t Count() const { return 0; }
+    uint32_t MaxUs() const { return 0; }
+    uint32_t Results(uint8_t result) const { return 0; }
+    uint32_t Bucket(int i) const { return 0; }
+    int Print(char *buff, int size, const char *name) const { return 0; }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,59 @@
+#include "bus_transport.h"
+
+//-----------------------------------------------------------------------------
+// SPI
+
+mbed_spi_transport::mbed_spi_transport(PinName mosi, PinName miso, PinName sclk, PinName cs, int mode, int hz)
+    : _spi(mosi, miso, sclk), _cs(cs)
+{
+    _cs = 1; //deselect chip
+    _spi.format(8, mode);
+    _spi.frequency(hz);
+}
+
+int mbed_spi_transport::transfer(const char *tx, int txLen, char *rx, int rxLen)
+{
+    _cs = 0;
+    int n = _spi.write(tx, txLen, rx, rxLen);
+    _cs = 1;
+    return n;
+}
+
+mbed_spi_cs_transport::mbed_spi_cs_transport(SPI &spi, PinName cs) : _spi(spi), _cs(cs)
+{
+    _cs = 1; //deselect chip
+}
+
+int mbed_spi_cs_transport::transfer(const char *tx, int txLen, char *rx, int rxLen)
+{
+    _cs = 0;
+    int n = _spi.write(tx, txLen, rx, rxLen);
+    _cs = 1;
+    return n;
+}
+
+//-----------------------------------------------------------------------------
+// I2C
+
+mbed_i2c_transport::mbed_i2c_transport(PinName sda, PinName scl, int hz) : _i2c(sda, scl)
+{
+    _i2c.frequency(hz);
+}
+
+int mbed_i2c_transport::write(int address, const char *data, int length, bool repeated)
+{
+    return _i2c.write(address, data, length, repeated);
+}
+
+int mbed_i2c_transport::read(int address, char *data, int length, bool repeated)
+{
+    return _i2c.read(address, data, length, repeated);
+}
+
+#if DEVICE_I2C_ASYNCH
+int mbed_i2c_transport::transfer(int address, const char *tx, int txLen, char *rx, int rxLen,
+                                 const event_callback_t &cb, int event, bool repeated)
+{
+    return _i2c.transfer(address, tx, txLen, rx, rxLen, cb, event, repeated);
+}
+#endif
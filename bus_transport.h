@@ -0,0 +1,137 @@
+#ifndef BUS_TRANSPORT_H
+#define BUS_TRANSPORT_H
+
+#include "mbed.h"
+
+// Bus transports under the drivers (max31865 on SPI, scd30 on I2C).
+//
+// A driver only sees spi_transport / i2c_transport. The mbed_ versions
+// below are the real hardware; bus_record.h adds a recorder that logs
+// every transaction and a replayer that serves a recording on Linux.
+
+    /** One SPI device: a transaction is a chip select low, tx/rx, chip select high
+     *
+     */
+class spi_transport {
+
+public:
+    virtual ~spi_transport() {}
+
+    /** Full duplex transfer inside one chip select
+     *
+     * @param bytes to send, 0xFF is clocked out once tx is exhausted
+     * @param number of bytes to send
+     * @param received bytes (may be NULL)
+     * @param number of bytes to receive
+     *
+     * @return number of bytes clocked, max(txLen, rxLen)
+     */
+    virtual int transfer(const char *tx, int txLen, char *rx, int rxLen) = 0;
+};
+
+    /** I2C master, same calling convention as mbed I2C
+     *
+     */
+class i2c_transport {
+
+public:
+    virtual ~i2c_transport() {}
+
+    /** Blocking write
+     *
+     * @param 8 bit address
+     * @param bytes to send
+     * @param number of bytes
+     * @param repeated start (no stop)
+     *
+     * @return 0 on success (ack), non-0 on failure
+     */
+    virtual int write(int address, const char *data, int length, bool repeated = false) = 0;
+
+    /** Blocking read
+     *
+     * @param 8 bit address
+     * @param received bytes
+     * @param number of bytes
+     * @param repeated start (no stop)
+     *
+     * @return 0 on success (ack), non-0 on failure
+     */
+    virtual int read(int address, char *data, int length, bool repeated = false) = 0;
+
+#if DEVICE_I2C_ASYNCH
+    /** Non-blocking transfer, see mbed I2C::transfer
+     *
+     * @return 0 if started, non-0 if busy or not supported
+     */
+    virtual int transfer(int address, const char *tx, int txLen, char *rx, int rxLen,
+                         const event_callback_t &cb, int event, bool repeated) { return -1; }
+#endif
+};
+
+//-----------------------------------------------------------------------------
+// Hardware
+
+class mbed_spi_transport : public spi_transport {
+
+public:
+    /** SPI bus and chip select owned by this transport
+     *
+     * @param MOSI, MISO, SCLK, CS pins
+     * @param SPI mode
+     * @param clock in Hz
+     *
+     * @return none
+     */
+    mbed_spi_transport(PinName mosi, PinName miso, PinName sclk, PinName cs, int mode = 0, int hz = 1000000);
+
+    virtual int transfer(const char *tx, int txLen, char *rx, int rxLen);
+
+private:
+    SPI _spi;
+    DigitalOut _cs;
+};
+
+class mbed_spi_cs_transport : public spi_transport {
+
+public:
+    /** One chip select on a SPI bus shared with other devices
+     *
+     * @param bus, format and frequency are set by its owner
+     * @param CS pin
+     *
+     * @return none
+     */
+    mbed_spi_cs_transport(SPI &spi, PinName cs);
+
+    virtual int transfer(const char *tx, int txLen, char *rx, int rxLen);
+
+private:
+    SPI &_spi;
+    DigitalOut _cs;
+};
+
+class mbed_i2c_transport : public i2c_transport {
+
+public:
+    /** I2C bus owned by this transport
+     *
+     * @param SDA, SCL pins
+     * @param clock in Hz
+     *
+     * @return none
+     */
+    mbed_i2c_transport(PinName sda, PinName scl, int hz);
+
+    virtual int write(int address, const char *data, int length, bool repeated = false);
+    virtual int read(int address, char *data, int length, bool repeated = false);
+#if DEVICE_I2C_ASYNCH
+    virtual int transfer(int address, const char *tx, int txLen, char *rx, int rxLen,
+                         const event_callback_t &cb, int event, bool repeated);
+#endif
+
+private:
+    I2C _i2c;
+};
+
+#endif
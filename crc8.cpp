@@ -0,0 +1,4 @@
+#include "crc8.h"
+
+// Built at compile time, placed in flash
+constexpr crc8 crc8_31(0x31);
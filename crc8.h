@@ -0,0 +1,81 @@
+#ifndef CRC8_H
+#define CRC8_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Table size is chosen at compile time:
+//   default            -> 256 entries, one lookup per byte
+//   CRC8_NIBBLE_TABLE  -> 16 entries, two lookups per byte (flash constrained builds)
+#ifdef CRC8_NIBBLE_TABLE
+#define CRC8_TABLE_BITS                 4
+#else
+#define CRC8_TABLE_BITS                 8
+#endif
+
+#define CRC8_TABLE_SIZE                 (1 << CRC8_TABLE_BITS)
+
+    /** Table driven CRC-8 (MSB first, no reflection, no final xor)
+     *
+     * The table is built by the compiler, it lives in flash as const data.
+     *
+     */
+class crc8 {
+
+public:
+    /** Build the lookup table for a polynomial
+     *
+     * @param 8 bit polynomial, x^8 omitted (0x31 for the Sensirion sensors)
+     *
+     * @return none
+     */
+    constexpr crc8(uint8_t poly) : table() {
+        for(int i = 0; i < CRC8_TABLE_SIZE; i++) {
+            uint8_t crc = i << (8 - CRC8_TABLE_BITS);
+            for(int bit = CRC8_TABLE_BITS; bit > 0; --bit) {
+                if(crc & 0x80) crc = (crc << 1) ^ poly;
+                else           crc = (crc << 1);
+            }
+            table[i] = crc;
+        }
+    }
+
+    /** Feed one byte into a running CRC
+     *
+     * @param running CRC value
+     * @param data byte
+     *
+     * @return new CRC value
+     */
+    uint8_t update(uint8_t crc, uint8_t data) const {
+#ifdef CRC8_NIBBLE_TABLE
+        crc ^= data;
+        crc = (crc << 4) ^ table[crc >> 4];
+        crc = (crc << 4) ^ table[crc >> 4];
+        return crc;
+#else
+        return table[crc ^ data];
+#endif
+    }
+
+    /** Calculate the CRC of a buffer
+     *
+     * @param initial CRC value
+     * @param pointer to the data
+     * @param number of bytes
+     *
+     * @return 8 bit CRC value
+     */
+    uint8_t compute(uint8_t crc, const uint8_t *data, size_t len) const {
+        while(len--) crc = update(crc, *data++);
+        return crc;
+    }
+
+private:
+    uint8_t table[CRC8_TABLE_SIZE];
+};
+
+// Shared instance for polynomial 0x31 (SCD30 and the inter-MCU frames)
+extern const crc8 crc8_31;
+
+#endif
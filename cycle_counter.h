@@ -0,0 +1,50 @@
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include "mbed.h"
+
+// Free running timestamp for short measurements (wraps, use differences):
+//  - Cortex-M3/M4/M7: DWT cycle counter, one tick per core clock
+//  - other Mbed targets: us ticker
+//  - host (sim): steady_clock in ns
+
+#if defined(DWT)
+
+class cycle_counter {
+    public:
+    static void Init()
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    static uint32_t Now() { return DWT->CYCCNT; }
+    static uint32_t Frequency() { return SystemCoreClock; }
+};
+
+#elif defined(DEVICE_USTICKER)
+
+class cycle_counter {
+    public:
+    static void Init() {}
+    static uint32_t Now() { return us_ticker_read(); }
+    static uint32_t Frequency() { return 1000000; }
+};
+
+#else
+
+#include <chrono>
+
+class cycle_counter {
+    public:
+    static void Init() {}
+    static uint32_t Now()
+    {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    static uint32_t Frequency() { return 1000000000; }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+
+// Streaming filter stages for sensor samples. Element type and window
+// length are template parameters, storage is static inside the object
+// (no heap) and each Update() is O(1) or, for the median, a fixed sorting
+// network. ACC is the accumulator type (use a wider integer for integer
+// samples, e.g. moving_average<int16_t, 16, int32_t>).
+
+//-----------------------------------------------------------------------------
+// Fixed size ring buffer, oldest element overwritten when full
+
+template <typename T, int N>
+class ring_buffer {
+    public:
+
+    ring_buffer() : buff(), head(0), count(0) {}
+
+    // add x, returns the element that fell out (only meaningful when Full() was true)
+    T Push(T x)
+    {
+        T old = buff[head];
+        buff[head] = x;
+        head = (head + 1) % N;
+        if (count < N) count++;
+        return old;
+    }
+
+    void Fill(T x)
+    {
+        for (int i = 0; i < N; i++) buff[i] = x;
+        head = 0;
+        count = N;
+    }
+
+    // i = 0 is the oldest element
+    T operator[](int i) const { return buff[(head + N - count + i) % N]; }
+
+    int Count() const { return count; }
+    bool Full() const { return count == N; }
+
+    private:
+    T buff[N];
+    int head, count;
+};
+
+//-----------------------------------------------------------------------------
+// Moving average over the last N samples, running sum
+
+template <typename T, int N, typename ACC = T>
+class moving_average {
+    public:
+
+    moving_average() : sum(0) {}
+
+    T Update(T x)
+    {
+        if (window.Full())
+        {
+            sum -= window.Push(x);
+        }
+        else
+        {
+            window.Push(x);
+        }
+        sum += x;
+        return (T)(sum / window.Count());
+    }
+
+    private:
+    ring_buffer<T, N> window;
+    ACC sum;
+};
+
+//-----------------------------------------------------------------------------
+// Sorting networks for the median, generic insertion sort otherwise
+
+template <typename T>
+inline void sort_swap(T *v, int a, int b)
+{
+    if (v[b] < v[a])
+    {
+        T t = v[a];
+        v[a] = v[b];
+        v[b] = t;
+    }
+}
+
+template <typename T, int N>
+struct sort_network {
+    static void Sort(T *v)
+    {
+        for (int i = 1; i < N; i++)
+        {
+            for (int j = i; j > 0 && v[j] < v[j - 1]; j--)
+            {
+                T t = v[j];
+                v[j] = v[j - 1];
+                v[j - 1] = t;
+            }
+        }
+    }
+};
+
+template <typename T>
+struct sort_network<T, 3> {
+    static void Sort(T *v)
+    {
+        sort_swap(v, 0, 1); sort_swap(v, 1, 2); sort_swap(v, 0, 1);
+    }
+};
+
+template <typename T>
+struct sort_network<T, 5> {
+    static void Sort(T *v)
+    {
+        sort_swap(v, 0, 1); sort_swap(v, 3, 4); sort_swap(v, 2, 4);
+        sort_swap(v, 2, 3); sort_swap(v, 0, 3); sort_swap(v, 0, 2);
+        sort_swap(v, 1, 4); sort_swap(v, 1, 3); sort_swap(v, 1, 2);
+    }
+};
+
+//-----------------------------------------------------------------------------
+// Median of the last N samples (N odd), rejects isolated spikes.
+// The window is primed with the first sample so the output is valid at once.
+
+template <typename T, int N>
+class median_filter {
+    public:
+
+    T Update(T x)
+    {
+        if (window.Count() == 0)
+        {
+            window.Fill(x);
+        }
+        else
+        {
+            window.Push(x);
+        }
+
+        T v[N];
+        for (int i = 0; i < N; i++) v[i] = window[i];
+        sort_network<T, N>::Sort(v);
+        return v[N / 2];
+    }
+
+    private:
+    ring_buffer<T, N> window;
+};
+
+//-----------------------------------------------------------------------------
+// Boxcar decimator: averages N samples, one output every N inputs
+
+template <typename T, int N, typename ACC = T>
+class boxcar_decimator {
+    public:
+
+    boxcar_decimator() : sum(0), n(0) {}
+
+    // returns true when out holds a new decimated sample
+    bool Update(T x, T &out)
+    {
+        sum += x;
+        if (++n < N)
+        {
+            return false;
+        }
+        out = (T)(sum / N);
+        sum = 0;
+        n = 0;
+        return true;
+    }
+
+    private:
+    ACC sum;
+    int n;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+// Signed Q16.16 fixed point number: 16 bits integer part, 16 bits fraction.
+// Multiplication uses a 64 bit intermediate, there is no division operator
+// so that the control code stays free of run time divides.
+class q16_16 {
+    public:
+
+    constexpr q16_16() : raw(0) {}
+    constexpr q16_16(float f) : raw((int32_t)(f * 65536.0f + (f >= 0 ? 0.5f : -0.5f))) {}
+
+    static constexpr q16_16 FromRaw(int32_t r)
+    {
+        return q16_16(r, 0);
+    }
+
+    explicit operator float() const
+    {
+        return raw * (1.0f / 65536.0f);
+    }
+
+    q16_16 operator-() const                  { return FromRaw(-raw); }
+    q16_16 operator+(q16_16 b) const          { return FromRaw(raw + b.raw); }
+    q16_16 operator-(q16_16 b) const          { return FromRaw(raw - b.raw); }
+    q16_16 operator*(q16_16 b) const          { return FromRaw((int32_t)(((int64_t)raw * b.raw) >> 16)); }
+    q16_16 &operator+=(q16_16 b)              { raw += b.raw; return *this; }
+    q16_16 &operator-=(q16_16 b)              { raw -= b.raw; return *this; }
+
+    bool operator<(q16_16 b) const            { return raw < b.raw; }
+    bool operator>(q16_16 b) const            { return raw > b.raw; }
+    bool operator<=(q16_16 b) const           { return raw <= b.raw; }
+    bool operator>=(q16_16 b) const           { return raw >= b.raw; }
+    bool operator==(q16_16 b) const           { return raw == b.raw; }
+    bool operator!=(q16_16 b) const           { return raw != b.raw; }
+
+    int32_t raw;
+
+    private:
+    constexpr q16_16(int32_t r, int) : raw(r) {}
+};
+
+#endif
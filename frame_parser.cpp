@@ -0,0 +1,101 @@
+#include "frame_parser.h"
+
+//-----------------------------------------------------------------------------
+// ASCII frame decoder
+
+frame_parser::frame_parser(frameCallback cb) : _cb(cb)
+{
+    _frames = 0;
+    _errors = 0;
+    _skipped = 0;
+    reset();
+}
+
+//-----------------------------------------------------------------------------
+
+void frame_parser::reset()
+{
+    _state = WAIT_START;
+    _type = 0;
+    _value = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+bool frame_parser::validType(uint8_t type)
+{
+    switch (type) {
+        case TELEMETRY_TEMPERATURE:
+        case TELEMETRY_HUMIDITE:
+        case TELEMETRY_PH:
+        case TELEMETRY_CO2:
+        case TELEMETRY_VISCOSITE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+bool frame_parser::feed(uint8_t c)
+{
+    switch (_state) {
+        case WAIT_START:
+            if (c == TELEMETRY_START) {
+                _state = WAIT_TYPE;
+            } else {
+                _skipped++;
+            }
+            return false;
+
+        case WAIT_TYPE:
+            if (!validType(c)) return resync(c);
+            _type = c;
+            _value = 0;
+            _state = WAIT_TENS;
+            return false;
+
+        case WAIT_TENS:
+        case WAIT_UNITS:
+        case WAIT_TENTHS:
+            if (c < '0' || c > '9') return resync(c);
+            _value = _value * 10 + (c - '0');
+            _state++;
+            return false;
+
+        case WAIT_END:
+            if (c != TELEMETRY_END) return resync(c);
+            _state = WAIT_START;
+            _frames++;
+            if (_cb) _cb(_type, _value);
+            return true;
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+
+int frame_parser::feed(const uint8_t *buff, size_t len)
+{
+    int n = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (feed(buff[i])) n++;
+    }
+    return n;
+}
+
+//-----------------------------------------------------------------------------
+// Unexpected byte inside a frame: drop it, a start byte begins the next one
+
+bool frame_parser::resync(uint8_t c)
+{
+    _errors++;
+    if (c == TELEMETRY_START) {
+        _state = WAIT_TYPE;
+    } else {
+        _state = WAIT_START;
+        _skipped++;
+    }
+    return false;
+}
@@ -0,0 +1,90 @@
+#ifndef FRAME_PARSER_H
+#define FRAME_PARSER_H
+
+#include "mbed.h"
+#include "telemetry.h"
+
+// Receiver for the ASCII frame of Envoie_Donners (no version byte)
+//
+//   0xAA | type | tens | units | tenths | 0xF0
+//
+// with digits in '0'..'9' and type one of the TELEMETRY_... codes (same
+// values as the temperature/humidite/pH/CO2/viscosite defines).
+
+    /** Byte at a time decoder, no buffer and no copy
+     *
+     * Only the digits seen so far are kept. 0xAA never appears inside a
+     * frame (types and digits are below 0x80), so a start byte anywhere
+     * restarts a frame: after a dropped byte the parser is back in sync on
+     * the next frame. Any other unexpected byte drops the partial frame.
+     *
+     * Safe to feed from the RX interrupt if the callback is short.
+     *
+     */
+class frame_parser {
+
+public:
+    /** Called for each complete frame
+     *
+     * @param type, TELEMETRY_... code
+     * @param value in tenths (0 to 999), donner * 10
+     */
+    typedef Callback<void(uint8_t, int)> frameCallback;
+
+    /** Create a parser
+     *
+     * @param callback for decoded frames
+     *
+     * @return none
+     */
+    frame_parser(frameCallback cb);
+
+    /** Decode one received byte
+     *
+     * @param received byte
+     *
+     * @return true if it completed a frame (callback already called)
+     */
+    bool feed(uint8_t c);
+
+    /** Decode a block of received bytes
+     *
+     * @param received bytes
+     * @param number of bytes
+     *
+     * @return number of frames completed
+     */
+    int feed(const uint8_t *buff, size_t len);
+
+    /** Drop any partial frame
+     *
+     * @return none
+     */
+    void reset();
+
+    uint32_t frames() const { return _frames; }     /**< valid frames */
+    uint32_t errors() const { return _errors; }     /**< partial frames dropped */
+    uint32_t skipped() const { return _skipped; }   /**< bytes outside any frame */
+
+    static bool validType(uint8_t type);
+
+private:
+    enum state {
+        WAIT_START,
+        WAIT_TYPE,
+        WAIT_TENS,
+        WAIT_UNITS,
+        WAIT_TENTHS,
+        WAIT_END,
+    };
+
+    frameCallback _cb;
+    uint8_t _state;
+    uint8_t _type;
+    int _value;
+    uint32_t _frames, _errors, _skipped;
+
+    bool resync(uint8_t c);
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include "mash_profile.h"
+#include <math.h>
+
+mash_profile::mash_profile(const mash_step steps[], int count, const mash_plant &plant, float band) : plant(plant)
+{
+    this->count = count > MASH_PROFILE_MAX_STEPS ? MASH_PROFILE_MAX_STEPS : count;
+    for (int i = 0; i < this->count; i++) this->steps[i] = steps[i];
+    this->band = band;
+    holdStart = feedforward = 0;
+
+    // without Start(): first ramp from the ambient temperature at t = 0
+    step = 0;
+    if (this->count) BeginStep(plant.ambient, 0);
+}
+
+void mash_profile::Start(float temperature, float t)
+{
+    step = 0;
+    if (count) BeginStep(temperature, t);
+}
+
+float mash_profile::Update(float temperature, float t)
+{
+    if (Done())
+    {
+        // after the last rest: hold its temperature
+        feedforward = count ? plant.loss * (setpoint - plant.ambient) / plant.power : 0;
+        return setpoint;
+    }
+
+    // the hold starts when the ramp is over and the water is at temperature
+    const mash_step &s = steps[step];
+    if (!holding && RampSetpoint(t) == s.temperature && temperature >= s.temperature - band
+        && temperature <= s.temperature + band)
+    {
+        holding = true;
+        holdStart = t;
+    }
+    if (holding && t - holdStart >= s.holdMin * 60)
+    {
+        step++;
+        if (!Done()) BeginStep(s.temperature, t);
+        return Update(temperature, t);
+    }
+
+    // setpoint now, feedforward for the setpoint lag seconds ahead
+    setpoint = RampSetpoint(t);
+    float ahead = RampSetpoint(t + plant.lag);
+    float rate = ahead == s.temperature ? 0 : RampRate(ahead);
+    feedforward = (plant.heatCapacity * rate + plant.loss * (ahead - plant.ambient)) / plant.power;
+    if (feedforward < 0) feedforward = 0;
+    if (feedforward > 1) feedforward = 1;
+    return setpoint;
+}
+
+void mash_profile::BeginStep(float from, float t)
+{
+    rampStart = t;
+    rampFrom = from;
+    holding = false;
+    setpoint = from;
+}
+
+float mash_profile::RampRate(float sp) const
+{
+    // degC/s, the fastest ramp slows down as the losses grow
+    const mash_step &s = steps[step];
+    if (s.rampRate > 0) return s.temperature >= rampFrom ? s.rampRate / 60 : -s.rampRate / 60;
+    if (s.temperature < rampFrom) return 0;
+    return MASH_PROFILE_MARGIN * (plant.power - plant.loss * (sp - plant.ambient)) / plant.heatCapacity;
+}
+
+float mash_profile::RampSetpoint(float t) const
+{
+    const mash_step &s = steps[step];
+    float target = s.temperature;
+    float dt = t - rampStart;
+    float sp;
+
+    if (s.rampRate > 0)
+    {
+        float rate = RampRate(rampFrom);
+        sp = rampFrom + rate * dt;
+        if ((rate >= 0 && sp > target) || (rate < 0 && sp < target)) sp = target;
+        return sp;
+    }
+
+    // fastest: only the heater can move the water, a cooling step is a plain setpoint step
+    if (target < rampFrom) return target;
+    if (plant.loss <= 0)
+    {
+        sp = rampFrom + RampRate(rampFrom) * dt;
+    }
+    else
+    {
+        // dx/dt = m (P - K x) / C with x = sp - Ta: exponential towards P / K
+        float xEnd = plant.power / plant.loss;
+        float x0 = rampFrom - plant.ambient;
+        sp = plant.ambient + xEnd - (xEnd - x0) * expf(-MASH_PROFILE_MARGIN * plant.loss / plant.heatCapacity * dt);
+    }
+    return sp > target ? target : sp;
+}
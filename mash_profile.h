@@ -0,0 +1,74 @@
+#ifndef MASH_PROFILE_H
+#define MASH_PROFILE_H
+
+// Mash schedule: a list of rests, each reached by a ramp and held for a
+// time, turned into a setpoint that moves with time plus a feedforward
+// heater duty for the PID.
+//
+// A ramp moves the setpoint at rampRate (degC/min), or when rampRate = 0
+// as fast as the heater can follow: MASH_PROFILE_MARGIN of the power left
+// after the losses at each temperature (the ramp slows down as it gets
+// hotter). The hold time starts once the ramp is over and the measurement
+// is within band of the rest temperature.
+//
+// Feedforward from the energy balance of the tank, at the setpoint lag
+// seconds ahead (the heat is still in the plate and the probe lags):
+//
+//   u_ff = (C dSP/dt + K (SP - Ta)) / P
+//
+// The PID only corrects the model error. Give it SetLimits(-u_ff, 1 - u_ff)
+// so its anti-windup sees the real saturation of the sum.
+
+#define MASH_PROFILE_MAX_STEPS          8
+#define MASH_PROFILE_MARGIN             0.95f   // part of the free power used by a fastest ramp
+
+struct mash_step {
+    float temperature;      // rest temperature (degC)
+    float rampRate;         // degC/min to get there, 0 = as fast as the heater allows
+    float holdMin;          // rest length (min), counted from the first time within band
+};
+
+struct mash_plant {
+    float heatCapacity;     // water + plate + tank (J/K)
+    float loss;             // to the air (W/K)
+    float power;            // heater (W)
+    float ambient;          // air temperature (degC)
+    float lag;              // heater to probe delay (s), about plate + probe time constants
+};
+
+class mash_profile {
+    public:
+
+    mash_profile(const mash_step steps[], int count, const mash_plant &plant, float band = 0.5f);
+
+    // start the first ramp from the current temperature, t in seconds
+    void Start(float temperature, float t);
+
+    // one period: returns the setpoint, Feedforward() is updated too
+    float Update(float temperature, float t);
+
+    float Setpoint() const { return setpoint; }
+    float Feedforward() const { return feedforward; }   // heater duty 0..1
+    int Step() const { return step; }                   // rest in progress, Count() when done
+    bool Holding() const { return holding; }
+    bool Done() const { return step >= count; }
+    int Count() const { return count; }
+
+    private:
+    mash_step steps[MASH_PROFILE_MAX_STEPS];
+    mash_plant plant;
+    int count;
+    float band;
+
+    int step;
+    float rampStart, rampFrom;             // current ramp: start time and temperature
+    bool holding;                          // at temperature, hold time running
+    float holdStart;
+    float setpoint, feedforward;
+
+    void BeginStep(float from, float t);
+    float RampSetpoint(float t) const;
+    float RampRate(float sp) const;
+};
+
+#endif
@@ -1,40 +1,138 @@
 #include "max31865.h"
 #include "mbed.h"
 
-max31865::max31865(PinName MOSI, PinName MISO, PinName SCLK, PinName CS) : spi(MOSI, MISO, SCLK), cs(CS) // mosi, miso, sclk
+max31865::max31865(PinName MOSI, PinName MISO, PinName SCLK, PinName CS)
 {
     //constructor
-    cs = 1; //deselect chip
-    spi.format(8,1); //set mode 1 and 8 bit
-    spi.frequency(500000); //set frequency to 0.5mhz
-    
-    
+    ownBus = new mbed_spi_transport(MOSI, MISO, SCLK, CS, 1, 500000); //mode 1, 8 bit, 0.5mhz
+    bus = ownBus;
+    config = 0; //power-on value of the config register
+    status = MAX31865_STATUS_OK;
+    faultBits = 0;
+}
+
+max31865::max31865(spi_transport &bus) : bus(&bus), ownBus(NULL)
+{
+    config = 0; //power-on value of the config register
+    status = MAX31865_STATUS_OK;
+    faultBits = 0;
+}
+
+max31865::~max31865()
+{
+    delete ownBus;
 }
 
 int max31865::ReadRTD()
 {
-    ClearFault();
-    EnableBias(true);
-    
-    int t = ReadRegistor8(MAX31856_CONFIG_REG);
-    t |= MAX31856_CONFIG_1SHOT;
-    WriteRegistor(MAX31856_CONFIG_REG, t);
-    
+    // result of the conversion started by the previous call, one period old:
+    // RTD and fault status are read and the fault cleared before the next 1 shot,
+    // a clear written during a conversion drops the fault it is latching
+    int RTD = ReadConversion();
+    StartConversion();
+    return RTD;
+}
+
+void max31865::StartConversion()
+{
+    // enable bias and start a 1 shot conversion in one write; no fault clear
+    // here, the chip ignores it when D5 (1 shot), D3 or D2 is written 1 with it
+    int t = config;
+    t &= ~0x2C;
+    t |= MAX31856_CONFIG_BIAS;
+    config = t;
+    WriteRegistor(MAX31856_CONFIG_REG, t | MAX31856_CONFIG_1SHOT);
+}
+
+int max31865::ReadConversion()
+{
     int RTD = ReadRegistor16(MAX31856_RTDMSB_REG);
     
+    // fault flag in the LSB, the status register is only read when it is set
+    CheckFault(RTD, -1);
+    
     // remove fault
     RTD >>= 1;
      
     return RTD;    
 }
 
+int max31865::ReadRTD(max31865_snapshot_t &snap)
+{
+    // same as ReadRTD() but the RTD, thresholds and fault status come in one burst
+    ReadSnapshot(snap);
+    CheckFault(snap.rtd, snap.fault);
+    StartConversion();
+    
+    // remove fault
+    return snap.rtd >> 1;
+}
+
+void max31865::ReadSnapshot(max31865_snapshot_t &snap)
+{
+    int buffer[7];
+    ReadRegistorN(MAX31856_RTDMSB_REG, buffer, 7);
+    
+    snap.rtd = (buffer[0] << 8) | buffer[1];
+    snap.highThresh = (buffer[2] << 8) | buffer[3];
+    snap.lowThresh = (buffer[4] << 8) | buffer[5];
+    snap.fault = buffer[6];
+}
+
+void max31865::CheckFault(int rtd, int fault)
+{
+    if (!(rtd & 1))
+    {
+        status = MAX31865_STATUS_OK;
+        faultBits = 0;
+        return;
+    }
+    
+    // fault < 0: not read yet
+    faultBits = fault < 0 ? ReadFault() : fault;
+    status = DecodeFault(faultBits);
+    
+    // latched until cleared: the clear goes in its own write, healthy reads never pay for it
+    ClearFault();
+}
+
+max31865_status_t max31865::DecodeFault(int bits)
+{
+    if (bits & MAX31865_FAULT_HIGHTHRESH) return MAX31865_STATUS_RTD_HIGH;
+    if (bits & MAX31865_FAULT_LOWTHRESH) return MAX31865_STATUS_RTD_LOW;
+    // D5 / D4: the defines keep the Adafruit names, the datasheet reads REFIN- > / < 0.85 x VBIAS
+    if (bits & MAX31865_FAULT_REFINLOW) return MAX31865_STATUS_REFIN_HIGH;
+    if (bits & MAX31865_FAULT_REFINHIGH) return MAX31865_STATUS_REFIN_LOW;
+    if (bits & MAX31865_FAULT_RTDINLOW) return MAX31865_STATUS_RTDIN_LOW;
+    if (bits & MAX31865_FAULT_OVUV) return MAX31865_STATUS_OVUV;
+    return MAX31865_STATUS_UNKNOWN;
+}
+
+const char *max31865::StatusName(max31865_status_t s)
+{
+    switch (s)
+    {
+        case MAX31865_STATUS_OK:            return "ok";
+        case MAX31865_STATUS_RTD_HIGH:      return "RTD high (open)";
+        case MAX31865_STATUS_RTD_LOW:       return "RTD low (short)";
+        case MAX31865_STATUS_REFIN_HIGH:    return "REFIN- high";
+        case MAX31865_STATUS_REFIN_LOW:     return "REFIN- low";
+        case MAX31865_STATUS_RTDIN_LOW:     return "RTDIN- low";
+        case MAX31865_STATUS_OVUV:          return "over/under voltage";
+        default:                            return "unknown";
+    }
+}
+
 void max31865::Begin(max31865_numwires_t wires)
 {
-    cs = 1;
+    Resync();
     SetWires(wires);
     EnableBias(false);
     AutoConvert(false);
-    ClearFault();   
+    ClearFault();
+    
+    // first conversion, so the first ReadRTD() has one to return
+    StartConversion();
 }
 
 int max31865::ReadFault()
@@ -44,15 +142,23 @@ int max31865::ReadFault()
 
 void max31865::ClearFault()
 {
-    int t = ReadRegistor8(MAX31856_CONFIG_REG);
+    // fault clear bit is self clearing, always written; D5, D3 and D2 must be 0
+    // in the same write or the chip ignores the clear
+    int t = config;
     t &= ~0x2C;
-    t |= MAX31856_CONFIG_FAULTSTAT;
-    WriteRegistor(MAX31856_CONFIG_REG, t);
+    config = t;
+    WriteRegistor(MAX31856_CONFIG_REG, t | MAX31856_CONFIG_FAULTSTAT);
+}
+
+void max31865::Resync()
+{
+    // reload the shadow copy from the chip (after a reset or a bus glitch)
+    config = ReadRegistor8(MAX31856_CONFIG_REG) & ~MAX31856_CONFIG_SELFCLEAR;
 }
 
 void max31865::EnableBias(bool b)
 {
-    int t = ReadRegistor8(MAX31856_CONFIG_REG);
+    int t = config;
     if (b)
     {
         t |= MAX31856_CONFIG_BIAS;       // enable bias
@@ -61,12 +167,12 @@ void max31865::EnableBias(bool b)
     {
         t &= ~MAX31856_CONFIG_BIAS;       // disable bias
     }
-    WriteRegistor(MAX31856_CONFIG_REG, t);
+    UpdateConfig(t);
 }
 
 void max31865::AutoConvert(bool b)
 {
-    int t = ReadRegistor8(MAX31856_CONFIG_REG);
+    int t = config;
     if (b)
     {
         t |= MAX31856_CONFIG_MODEAUTO;       // enable autoconvert
@@ -75,12 +181,12 @@ void max31865::AutoConvert(bool b)
     {
         t &= ~MAX31856_CONFIG_MODEAUTO;       // disable autoconvert
     }
-    WriteRegistor(MAX31856_CONFIG_REG, t);   
+    UpdateConfig(t);   
 }
 
 void max31865::SetWires(max31865_numwires_t wires )
 {
-    int t = ReadRegistor8(MAX31856_CONFIG_REG);
+    int t = config;
     
     if (wires == MAX31865_3WIRE) 
     {
@@ -91,10 +197,21 @@ void max31865::SetWires(max31865_numwires_t wires )
         // 2 or 4 wire
         t &= ~MAX31856_CONFIG_3WIRE;
     }
-    WriteRegistor(MAX31856_CONFIG_REG, t);
+    UpdateConfig(t);
 }
 
 
+void max31865::UpdateConfig(int t)
+{
+    // only talk to the chip when a bit actually changes
+    if (t == config)
+    {
+        return;
+    }
+    config = t;
+    WriteRegistor(MAX31856_CONFIG_REG, t);
+}
+
 int max31865::ReadRegistor8(int address)
 {
     int ret = 0;
@@ -116,32 +233,40 @@ int max31865::ReadRegistor16(int address)
 
 void max31865::ReadRegistorN(int address, int buffer[], int n)
 {
-    address &= 0x7F; // make sure top bit is not set 
-     
-    cs = 0;
-     
-    spiXfer(address);
-     
-    while(n--)
+    char tx[MAX31865_BURST_MAX];
+    char rx[MAX31865_BURST_MAX];
+    
+    tx[0] = address & 0x7F; // make sure top bit is not set 
+    for (int i = 1; i <= n; i++)
     {
-        buffer[0] = spiXfer(0xFF);
-        buffer++;   
+        tx[i] = 0xFF;
     }
+     
+    uint32_t start = readStats.Start();
+    bus->transfer(tx, n + 1, rx, n + 1); // address and all data bytes in one chip select
     
-    cs = 1;
+    int floating = MAX31865_BUS_FLOATING;
+    for (int i = 0; i < n; i++)
+    {
+        buffer[i] = (uint8_t)rx[i + 1];
+        if (buffer[i] != 0xFF) floating = MAX31865_BUS_OK;
+    }
+    readStats.Stop(start, floating);
 }
 
 void max31865::WriteRegistor(int address, int data)
 {
+    char tx[2];
+    tx[0] = address | 0x80;   // make sure top bit is set
+    tx[1] = data;
     
-    cs = 0; //select chip
-    spiXfer(address | 0x80);   // make sure top bit is set
-    spiXfer(data);
-    
-    cs = 1;
+    uint32_t start = writeStats.Start();
+    bus->transfer(tx, 2, NULL, 0);
+    writeStats.Stop(start, MAX31865_BUS_OK);
 }
 
-int max31865::spiXfer(int x)
+void max31865::ResetStats()
 {
-    return spi.write(x);   
+    readStats.Reset();
+    writeStats.Reset();
 }
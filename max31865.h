@@ -2,6 +2,8 @@
 #define MBED_MAX31865_H
 
 #include "mbed.h"
+#include "bus_transport.h"
+#include "bus_stats.h"
 
 #define MAX31856_CONFIG_REG            0x00
 #define MAX31856_CONFIG_BIAS           0x80
@@ -13,6 +15,7 @@
 #define MAX31856_CONFIG_FAULTSTAT      0x02
 #define MAX31856_CONFIG_FILT50HZ       0x01
 #define MAX31856_CONFIG_FILT60HZ       0x00
+#define MAX31856_CONFIG_SELFCLEAR      (MAX31856_CONFIG_1SHOT | MAX31856_CONFIG_FAULTSTAT)
 
 #define MAX31856_RTDMSB_REG           0x01
 #define MAX31856_RTDLSB_REG           0x02
@@ -22,6 +25,13 @@
 #define MAX31856_LFAULTLSB_REG        0x06
 #define MAX31856_FAULTSTAT_REG        0x07
 
+#define MAX31865_BURST_MAX            8     // address byte + registers 0x01..0x07
+#define MAX31865_CONVERSION_US        65000 // 1 shot conversion: 52 ms (60 Hz filter), 62.5 ms (50 Hz filter)
+
+// result codes in the bus statistics
+#define MAX31865_BUS_OK               0
+#define MAX31865_BUS_FLOATING         1     // every byte read 0xFF: MISO pulled up, chip absent or unpowered
+
 
 #define MAX31865_FAULT_HIGHTHRESH     0x80
 #define MAX31865_FAULT_LOWTHRESH      0x40
@@ -30,37 +40,82 @@
 #define MAX31865_FAULT_RTDINLOW       0x08
 #define MAX31865_FAULT_OVUV           0x04
 
+// state of the last conversion, from the RTD LSB fault flag and, only when
+// it is set, the fault status register (highest fault bit wins)
+typedef enum max31865_status {
+  MAX31865_STATUS_OK = 0,
+  MAX31865_STATUS_RTD_HIGH,     // above the high threshold: RTD open
+  MAX31865_STATUS_RTD_LOW,      // below the low threshold: RTD shorted
+  MAX31865_STATUS_REFIN_HIGH,   // REFIN- > 0.85 x VBIAS
+  MAX31865_STATUS_REFIN_LOW,    // REFIN- < 0.85 x VBIAS, FORCE- open
+  MAX31865_STATUS_RTDIN_LOW,    // RTDIN- < 0.85 x VBIAS, FORCE- open
+  MAX31865_STATUS_OVUV,         // over or under voltage on an input
+  MAX31865_STATUS_UNKNOWN       // fault flag set but no fault bit (bus glitch)
+} max31865_status_t;
+
 typedef enum max31865_numwires { 
   MAX31865_2WIRE = 0,
   MAX31865_3WIRE = 1,
   MAX31865_4WIRE = 0
 } max31865_numwires_t;
 
+// registers 0x01..0x07 as read in one chip select, values in chip order
+typedef MBED_PACKED(struct) max31865_snapshot {
+  uint16_t rtd;          // RTD MSB/LSB, fault flag in bit 0
+  uint16_t highThresh;   // high fault threshold MSB/LSB
+  uint16_t lowThresh;    // low fault threshold MSB/LSB
+  uint8_t fault;         // fault status
+} max31865_snapshot_t;
+
 class max31865 {
     public:
     
     max31865(PinName MOSI, PinName MISO, PinName SCLK, PinName CS);
+    max31865(spi_transport &bus); // recorded, replayed or shared bus
+    ~max31865();
     
     void Begin(max31865_numwires_t x = MAX31865_2WIRE);
     int ReadFault();
     void ClearFault();
-    int ReadRTD();
+    void Resync();
+    int ReadRTD(); // conversion started by the previous call (or Begin()), then the next one
+    void StartConversion(); // bias on and 1 shot in one write
+    int ReadConversion(); // RTD code, MAX31865_CONVERSION_US after StartConversion()
+    
+    // fault of the last RTD read: no extra transaction while the probe is healthy,
+    // a fault costs the status read and a separate fault clear write
+    max31865_status_t Status() const { return status; }
+    int FaultBits() const { return faultBits; } // fault status register, 0 when healthy
+    static max31865_status_t DecodeFault(int bits);
+    static const char *StatusName(max31865_status_t s);
+    int ReadRTD(max31865_snapshot_t &snap);
+    void ReadSnapshot(max31865_snapshot_t &snap);
     
     void SetWires(max31865_numwires_t wires);
     void AutoConvert(bool b);
     void EnableBias(bool b);
     
+    // register reads / writes: latency histogram and results (MAX31865_BUS_...)
+    const bus_stats &ReadStats() const { return readStats; }
+    const bus_stats &WriteStats() const { return writeStats; }
+    void ResetStats();
+    
     private:
-    SPI spi;
-    DigitalOut cs;
+    spi_transport *bus;
+    mbed_spi_transport *ownBus; // created by the pin constructor
+    int config; // shadow copy of the config register, self clearing bits excluded
+    max31865_status_t status;
+    int faultBits;
+    bus_stats readStats, writeStats;
     
+    void UpdateConfig(int t);
+    void CheckFault(int rtd, int fault);
     void ReadRegistorN(int address, int buffer[], int n);
     
     int ReadRegistor8(int address);
     int ReadRegistor16(int address);
     
     void WriteRegistor(int address, int reg);
-    int spiXfer(int address);
 };
 
 
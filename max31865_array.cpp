@@ -0,0 +1,67 @@
+#include "max31865_array.h"
+
+max31865_array::max31865_array(PinName MOSI, PinName MISO, PinName SCLK, const PinName CS[], int n)
+{
+    count = n > MAX31865_ARRAY_MAX ? MAX31865_ARRAY_MAX : n;
+    spi = new SPI(MOSI, MISO, SCLK);
+    spi->format(8, 1); //mode 1, 8 bit, 0.5mhz, same as a single max31865
+    spi->frequency(500000);
+    for (int i = 0; i < count; i++)
+    {
+        cs[i] = new mbed_spi_cs_transport(*spi, CS[i]);
+        probe[i] = new max31865(*cs[i]);
+    }
+}
+
+max31865_array::max31865_array(spi_transport *const bus[], int n) : spi(NULL)
+{
+    count = n > MAX31865_ARRAY_MAX ? MAX31865_ARRAY_MAX : n;
+    for (int i = 0; i < count; i++)
+    {
+        cs[i] = NULL;
+        probe[i] = new max31865(*bus[i]);
+    }
+}
+
+max31865_array::~max31865_array()
+{
+    for (int i = 0; i < count; i++)
+    {
+        delete probe[i];
+        delete cs[i];
+    }
+    delete spi;
+}
+
+void max31865_array::Begin(max31865_numwires_t wires)
+{
+    for (int i = 0; i < count; i++)
+    {
+        probe[i]->Begin(wires);
+    }
+    wait_us(MAX31865_CONVERSION_US);
+}
+
+void max31865_array::StartConversions()
+{
+    // the chips convert in parallel, only the bus is shared
+    for (int i = 0; i < count; i++)
+    {
+        probe[i]->StartConversion();
+    }
+}
+
+void max31865_array::ReadConversions(int rtd[])
+{
+    for (int i = 0; i < count; i++)
+    {
+        rtd[i] = probe[i]->ReadConversion();
+    }
+}
+
+void max31865_array::ReadRTD(int rtd[])
+{
+    StartConversions();
+    wait_us(MAX31865_CONVERSION_US);
+    ReadConversions(rtd);
+}
@@ -0,0 +1,53 @@
+#ifndef MAX31865_ARRAY_H
+#define MAX31865_ARRAY_H
+
+#include "mbed.h"
+#include "max31865.h"
+
+// Several MAX31865 on one SPI bus, one chip select each (top, bottom,
+// heating plate...).
+//
+// A sweep starts a 1 shot conversion on every probe back to back (one
+// 2 byte write each), waits once for the conversion window, then reads
+// the RTD registers of every probe: N probes cost about one conversion
+// time instead of N.
+//
+//   PinName cs[] = { PA_11, PA_12, PB_0 };
+//   max31865_array sondes(PB_5, PB_4, PB_3, cs, 3);
+//   sondes.Begin(MAX31865_3WIRE);              // blocks MAX31865_CONVERSION_US once
+//   sondes.ReadRTD(codes);                     // blocks MAX31865_CONVERSION_US
+//
+// or without blocking, from an EventQueue:
+//   sondes.StartConversions();
+//   queue.call_in(MAX31865_CONVERSION_US / 1000, Collect);   // Collect calls ReadConversions(codes)
+
+#define MAX31865_ARRAY_MAX            8
+
+class max31865_array {
+    public:
+
+    max31865_array(PinName MOSI, PinName MISO, PinName SCLK, const PinName CS[], int n);
+    max31865_array(spi_transport *const bus[], int n); // recorded or replayed buses, one per probe
+    ~max31865_array();
+
+    // Begin() on every probe, which turns the bias on and starts a first 1 shot,
+    // then one wait for them: the first sweep never restarts a running conversion
+    void Begin(max31865_numwires_t wires = MAX31865_2WIRE);
+
+    void StartConversions();
+    void ReadConversions(int rtd[]);
+
+    // start, wait once, collect: rtd[i] is the code of probe i
+    void ReadRTD(int rtd[]);
+
+    int Count() const { return count; }
+    max31865 &Probe(int i) { return *probe[i]; }
+
+    private:
+    SPI *spi; // shared bus, created by the pin constructor
+    mbed_spi_cs_transport *cs[MAX31865_ARRAY_MAX];
+    max31865 *probe[MAX31865_ARRAY_MAX];
+    int count;
+};
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef PID_H
+#define PID_H
+
+// PID controller for a fixed sample period, T = float or q16_16.
+//
+//  - gains and period are folded into coefficients once, Update() is a fixed
+//    number of multiply/add/compare, no division
+//  - output clamped to [outMin, outMax] (0..1 for a relay_output or a PwmOut)
+//  - anti-windup by conditional integration: the integral only moves when it
+//    does not push a saturated output further into saturation
+//  - derivative on measurement (no kick on setpoint steps), first order
+//    filter with time constant tf
+//  - bumpless setpoint and gain changes: the integral absorbs the step of the
+//    proportional term so the output stays continuous (needs ki != 0)
+//
+// pid_law() is one period of that law on state passed by reference, and
+// pid_gains(), pid_setpoint(), pid_reset() and pid_clamp() the changes around
+// it, shared with tank_controller.h which keeps the same state in one array
+// per field.
+
+template <typename T>
+inline T pid_clamp(T u, T outMin, T outMax)
+{
+    if (u > outMax) return outMax;
+    if (u < outMin) return outMin;
+    return u;
+}
+
+// one period: error, filtered derivative, conditional integration, clamped output
+template <typename T>
+inline T pid_law(T sp, T measurement, T kp, T kiDt, T kdDt, T alpha, T outMin, T outMax,
+                 T &integ, T &deriv, T &prevMeas, T &lastError)
+{
+    T e = sp - measurement;
+    lastError = e;
+
+    deriv = alpha * deriv - kdDt * (measurement - prevMeas);
+    prevMeas = measurement;
+
+    T u = kp * e + integ + deriv;
+    T di = kiDt * e;
+    T uNext = u + di;
+    if (!((uNext > outMax && di > T(0.0f)) || (uNext < outMin && di < T(0.0f))))
+    {
+        integ += di;
+        u = uNext;
+    }
+
+    return pid_clamp(u, outMin, outMax);
+}
+
+// gains folded into coefficients, bumpless: the integral takes the step of
+// the proportional term on the last error (skip before the first period or
+// with ki == 0, there is no integral to carry it)
+template <typename T>
+inline void pid_gains(float kp, float ki, float kd, float dt, float tf, bool bumpless,
+                      T &kpOut, T &kiDt, T &kdDt, T &alpha, T &integ, T lastError)
+{
+    T newKp = T(kp);
+    if (bumpless)
+    {
+        integ += (kpOut - newKp) * lastError;
+    }
+    kpOut = newKp;
+    kiDt = T(ki * dt);
+    alpha = T(tf / (tf + dt));
+    kdDt = T(kd / (tf + dt));
+}
+
+// new setpoint, bumpless: the integral takes the step of the proportional term
+template <typename T>
+inline void pid_setpoint(T setpoint, bool bumpless, T kp, T &sp, T &integ, T &lastError)
+{
+    if (bumpless)
+    {
+        integ -= kp * (setpoint - sp);
+    }
+    lastError += setpoint - sp;
+    sp = setpoint;
+}
+
+// restart from the plant state, integral preloaded so the first output is u,
+// returns u clamped
+template <typename T>
+inline T pid_reset(T sp, T measurement, T u, T kp, T outMin, T outMax,
+                   T &integ, T &deriv, T &prevMeas, T &lastError)
+{
+    prevMeas = measurement;
+    lastError = sp - measurement;
+    deriv = T(0.0f);
+    integ = u - kp * lastError;
+    return pid_clamp(u, outMin, outMax);
+}
+
+template <typename T>
+class pid {
+    public:
+
+    pid(float kp, float ki, float kd, float dt, float tf = 0, float outMin = 0, float outMax = 1)
+        : sp(0.0f), integ(0.0f), deriv(0.0f), prevMeas(0.0f), lastError(0.0f), out(0.0f), first(true)
+    {
+        this->dt = dt;
+        this->tf = tf;
+        SetLimits(outMin, outMax);
+        SetGains(kp, ki, kd);
+    }
+
+    // new gains, the output does not jump
+    void SetGains(float kp, float ki, float kd)
+    {
+        pid_gains(kp, ki, kd, dt, tf, ki != 0 && !first, this->kp, kiDt, kdDt, alpha, integ, lastError);
+        this->ki = ki;
+    }
+
+    void SetLimits(float outMin, float outMax)
+    {
+        this->outMin = T(outMin);
+        this->outMax = T(outMax);
+    }
+
+    // new setpoint, bumpless when ki != 0
+    void SetSetpoint(T setpoint)
+    {
+        pid_setpoint(setpoint, ki != 0 && !first, kp, sp, integ, lastError);
+    }
+
+    // setpoint that moves every period (ramp): no bumpless compensation, the
+    // proportional term acts on the tracking error
+    void SetTrajectory(T setpoint)
+    {
+        pid_setpoint(setpoint, false, kp, sp, integ, lastError);
+    }
+
+    // restart from the current plant state, integral preloaded so the first output is u
+    void Reset(T measurement, T u)
+    {
+        out = pid_reset(sp, measurement, u, kp, outMin, outMax, integ, deriv, prevMeas, lastError);
+        first = false;
+    }
+
+    T Update(T measurement)
+    {
+        if (first)
+        {
+            prevMeas = measurement;
+            first = false;
+        }
+
+        out = pid_law(sp, measurement, kp, kiDt, kdDt, alpha, outMin, outMax, integ, deriv, prevMeas, lastError);
+        return out;
+    }
+
+    T Setpoint() const { return sp; }
+    T Output() const { return out; }
+    T Integral() const { return integ; }
+    T Derivative() const { return deriv; }
+
+    private:
+    float dt, tf, ki;
+    T kp, kiDt, kdDt, alpha, outMin, outMax;
+    T sp, integ, deriv, prevMeas, lastError, out;
+    bool first;
+};
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "mbed.h"
+#include "cycle_counter.h"
+
+// Scoped-zone profiler for the control loop, fixed static storage.
+//
+//   profile_zone Zone_mesure("mesure");
+//   void Regulation() { PROFILE_SCOPE(Zone_mesure); ... }
+//
+// Each zone keeps count, min / mean / max and a log2 histogram of its
+// duration in cycle_counter ticks (CPU cycles on Cortex-M, ns on Linux).
+// profile_period does the same for the deviation of a periodic task from
+// its nominal period (jitter). Zones link themselves in a list at
+// construction, so a report can walk all of them.
+//
+// Recording is a few adds and compares, no allocation. Printing is left to
+// the caller, from the same thread as the measured code so nothing races.
+
+#define PROFILER_BUCKETS                32      //bucket 0: 0 ticks, bucket i: 2^(i-1) .. 2^i - 1 ticks, the last one up to 2^32 - 1
+#define PROFILER_LINE_SIZE              192     //enough for Print()
+
+class profile_zone {
+    public:
+
+    profile_zone(const char *name) : name(name), next(NULL)
+    {
+        cycle_counter::Init();
+        Reset();
+        // append, the report keeps the declaration order
+        profile_zone **p = &First();
+        while (*p) p = &(*p)->next;
+        *p = this;
+    }
+
+    void Add(uint32_t ticks)
+    {
+        if (count == 0 || ticks < min) min = ticks;
+        if (ticks > max) max = ticks;
+        sum += ticks;
+        count++;
+        int bucket = ticks ? 32 - __builtin_clz(ticks) : 0;
+        histogram[bucket < PROFILER_BUCKETS ? bucket : PROFILER_BUCKETS - 1]++;
+    }
+
+    void Reset()
+    {
+        count = 0;
+        min = max = 0;
+        sum = 0;
+        memset(histogram, 0, sizeof(histogram));
+    }
+
+    const char *Name() const { return name; }
+    uint32_t Count() const { return count; }
+    uint32_t Min() const { return min; }
+    uint32_t Max() const { return max; }
+    uint32_t Mean() const { return count ? (uint32_t)(sum / count) : 0; }
+    uint32_t Bucket(int i) const { return histogram[i]; }
+    profile_zone *Next() const { return next; }
+
+    static profile_zone *&First()
+    {
+        static profile_zone *first = NULL;
+        return first;
+    }
+
+    static float Microseconds(uint32_t ticks) { return ticks * (1e6f / cycle_counter::Frequency()); }
+
+    // one line: name n=count min/mean/max in us, h@first=bucket counts (empty ends cut)
+    int Print(char *buff, int size) const
+    {
+        int n = snprintf(buff, size, "%s n=%lu min=%.1fus mean=%.1fus max=%.1fus h@", name, (unsigned long)count,
+                         Microseconds(min), Microseconds(Mean()), Microseconds(max));
+        int first = 0, last = PROFILER_BUCKETS - 1;
+        while (first < last && histogram[first] == 0) first++;
+        while (last > first && histogram[last] == 0) last--;
+        if (n < size) n += snprintf(buff + n, size - n, "%d=", first);
+        for (int i = first; i <= last && n < size; i++)
+        {
+            n += snprintf(buff + n, size - n, i < last ? "%lu," : "%lu", (unsigned long)histogram[i]);
+        }
+        return n < size ? n : size - 1;
+    }
+
+    private:
+    const char *name;
+    profile_zone *next;
+    uint32_t count;
+    uint32_t min, max;
+    uint64_t sum;
+    uint32_t histogram[PROFILER_BUCKETS];
+};
+
+// times the enclosing block
+class profile_scope {
+    public:
+    profile_scope(profile_zone &zone) : zone(zone), start(cycle_counter::Now()) {}
+    ~profile_scope() { zone.Add(cycle_counter::Now() - start); }
+    private:
+    profile_zone &zone;
+    uint32_t start;
+};
+
+#define PROFILE_CONCAT2(a, b)           a##b
+#define PROFILE_CONCAT(a, b)            PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(zone)             profile_scope PROFILE_CONCAT(profileScope, __LINE__)(zone)
+
+// period of a periodic task: the zone histogram holds |period - nominal|,
+// the signed extremes are kept apart (early / late)
+class profile_period {
+    public:
+
+    profile_period(const char *name, uint32_t nominalUs) : zone(name), last(0), started(false)
+    {
+        nominal = nominalUs * (cycle_counter::Frequency() / 1000000);
+        early = late = 0;
+    }
+
+    // call at the start of each period
+    void Tick()
+    {
+        uint32_t now = cycle_counter::Now();
+        if (started)
+        {
+            int32_t deviation = (int32_t)(now - last - nominal);
+            if (deviation < early) early = deviation;
+            if (deviation > late) late = deviation;
+            zone.Add(deviation < 0 ? -deviation : deviation);
+        }
+        last = now;
+        started = true;
+    }
+
+    void Reset()
+    {
+        zone.Reset();
+        early = late = 0;
+    }
+
+    int32_t Early() const { return early; }     // most negative deviation, ticks
+    int32_t Late() const { return late; }       // most positive deviation, ticks
+    const profile_zone &Zone() const { return zone; }
+
+    private:
+    profile_zone zone;
+    uint32_t nominal;
+    uint32_t last;
+    bool started;
+    int32_t early, late;
+};
+
+#endif
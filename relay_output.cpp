@@ -0,0 +1,151 @@
+#include "relay_output.h"
+
+relay_output::relay_output(PinName pin, EventQueue *queue, int windowMs, int minOnMs, int minOffMs,
+                           PinName zeroCross, int mainsHz)
+    : out(pin, 0), queue(queue), zc(NULL)
+{
+    windowUs = windowMs * 1000;
+    minOnUs = minOnMs * 1000;
+    minOffUs = minOffMs * 1000;
+    halfCycleUs = 500000 / mainsHz;
+    duty = 0;
+    carry = 0;
+    windowId = offId = 0;
+    armed = false;
+    halfCycles = remaining = 0;
+    switches = 0;
+    requestedUs = deliveredUs = onSinceUs = 0;
+    clock.start();
+
+    if (zeroCross != NC)
+    {
+        zc = new InterruptIn(zeroCross);
+        zc->rise(callback(this, &relay_output::ZeroCross));
+        zc->fall(callback(this, &relay_output::ZeroCross));
+    }
+}
+
+relay_output::~relay_output()
+{
+    if (windowId) queue->cancel(windowId);
+    if (offId) queue->cancel(offId);
+    delete zc;
+}
+
+void relay_output::Start()
+{
+    if (windowId) return;
+    Window();
+    windowId = queue->call_every(windowUs / 1000, callback(this, &relay_output::Window));
+}
+
+void relay_output::write(float duty)
+{
+    // clamp, NaN included
+    if (!(duty > 0)) duty = 0;
+    if (duty > 1) duty = 1;
+    this->duty = duty;
+}
+
+void relay_output::Shutdown()
+{
+    duty = 0;
+    carry = 0;
+    // a zero crossing in between would switch the pulse back on
+    core_util_critical_section_enter();
+    armed = false;
+    remaining = 0;
+    Set(0);
+    core_util_critical_section_exit();
+}
+
+void relay_output::Window()
+{
+    // requested on time plus what earlier windows owe
+    int32_t request = (int32_t)(duty * windowUs);
+    int32_t on = request + carry;
+    requestedUs += request;
+
+    // never a pulse or a gap shorter than the relay minimums
+    if (on < minOnUs) on = 0;
+    else if (on > windowUs - minOffUs) on = windowUs;
+
+    // whole half cycles with zero-cross, whole ms for the EventQueue otherwise
+    if (on < windowUs) on -= on % (zc ? halfCycleUs : 1000);
+
+    carry += request - on;
+    int32_t carryMax = RELAY_OUTPUT_CARRY_WINDOWS * windowUs;
+    if (carry > carryMax) carry = carryMax;
+    if (carry < -carryMax) carry = -carryMax;
+
+    if (zc)
+    {
+        // switched by the next zero crossings, armed with the pulse length
+        core_util_critical_section_enter();
+        halfCycles = on >= windowUs ? -1 : on / halfCycleUs;
+        armed = true;
+        core_util_critical_section_exit();
+        return;
+    }
+
+    if (offId)
+    {
+        queue->cancel(offId);
+        offId = 0;
+    }
+    Set(on > 0);
+    if (on > 0 && on < windowUs)
+    {
+        offId = queue->call_in(on / 1000, callback(this, &relay_output::Off));
+    }
+}
+
+void relay_output::Off()
+{
+    offId = 0;
+    Set(0);
+}
+
+void relay_output::Set(int v)
+{
+    // reached from the queue and from the zero-cross interrupt: the pin test,
+    // the count and the write must not be split. The on time is taken at the
+    // edges, so a pulse cut by Shutdown() only counts what was served
+    core_util_critical_section_enter();
+    if (v && !out.read())
+    {
+        switches++;
+        onSinceUs = clock.read_high_resolution_us();
+    }
+    else if (!v && out.read())
+    {
+        deliveredUs += clock.read_high_resolution_us() - onSinceUs;
+    }
+    out = v;
+    core_util_critical_section_exit();
+}
+
+uint64_t relay_output::DeliveredUs()
+{
+    core_util_critical_section_enter();
+    uint64_t us = deliveredUs;
+    if (out.read()) us += clock.read_high_resolution_us() - onSinceUs;
+    core_util_critical_section_exit();
+    return us;
+}
+
+void relay_output::ZeroCross()
+{
+    // interrupt, both edges: one call per mains half cycle
+    if (armed)
+    {
+        armed = false;
+        remaining = halfCycles;
+        Set(remaining != 0);
+        return;
+    }
+    if (remaining > 0 && --remaining == 0)
+    {
+        Set(0);
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef RELAY_OUTPUT_H
+#define RELAY_OUTPUT_H
+
+#include "mbed.h"
+
+// Time-proportioning output for a heater relay (mechanical or SSR).
+//
+// The duty (0..1, clamped) is turned into one on pulse at the start of
+// each window. A pulse shorter than minOn is not sent and a gap shorter
+// than minOff is filled, the difference is carried to the next windows
+// (sigma-delta): a small duty becomes an occasional minOn pulse instead of
+// chattering, and over time the delivered on time equals the requested one.
+//
+// Windows are paced by the EventQueue of the program. With a zero-cross
+// detector on an InterruptIn (SSR), the pulse is counted in mains half
+// cycles and switched from the zero-cross interrupt, so the load always
+// switches at a zero crossing.
+//
+// Same use as the PwmOut it replaces:
+//   relay_output Relais(PA_8, &File_evenements, 5000, 500, 500);
+//   Relais.Start();
+//   Relais = Puissance;
+
+#define RELAY_OUTPUT_CARRY_WINDOWS      2       //carry bounded to +/- this many windows of on time
+
+class relay_output {
+    public:
+
+    /** Relay on a pin, windows paced by queue
+     *
+     * @param pin, 1 = heater on
+     * @param queue running the windows
+     * @param window length in ms
+     * @param shortest on pulse in ms
+     * @param shortest off gap in ms
+     * @param zero-cross input (both edges), NC = timed switching
+     * @param mains frequency for the zero-cross half cycles
+     *
+     * @return none
+     */
+    relay_output(PinName pin, EventQueue *queue, int windowMs = 5000, int minOnMs = 500, int minOffMs = 500,
+                 PinName zeroCross = NC, int mainsHz = 50);
+    ~relay_output();
+
+    // first window now, every windowMs after
+    void Start();
+
+    // duty for the next windows, 0..1
+    void write(float duty);
+    float read() { return duty; }
+    relay_output &operator=(float duty) { write(duty); return *this; }
+    operator float() { return duty; }
+
+    // off now, mid window, and forget the carry (sensor fault, emergency)
+    void Shutdown();
+
+    int State() { return out.read(); }
+    unsigned Switches() const { return switches; }          // off -> on transitions, contact wear
+    uint64_t RequestedUs() const { return requestedUs; }    // duty x window summed over the windows
+    uint64_t DeliveredUs();                                 // on time at the pin, current pulse included
+
+    private:
+    DigitalOut out;
+    EventQueue *queue;
+    InterruptIn *zc;
+    Timer clock;                    // on time measured between the pin edges
+    int windowUs, minOnUs, minOffUs, halfCycleUs;
+    float duty;
+    int32_t carry;                  // requested - delivered, us
+    int windowId, offId;
+
+    volatile bool armed;            // zero-cross: a new window is waiting for the next edge
+    volatile int halfCycles;        // its pulse length, -1 = whole window
+    volatile int remaining;         // half cycles left in the current pulse, -1 = stay on
+
+    unsigned switches;
+    uint64_t requestedUs, deliveredUs;
+    uint64_t onSinceUs;             // clock at the last off -> on edge
+
+    void Window();
+    void Off();
+    void Set(int v);
+    void ZeroCross();
+};
+
+#endif
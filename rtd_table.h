@@ -0,0 +1,69 @@
+#ifndef RTD_TABLE_H
+#define RTD_TABLE_H
+
+#include <stdint.h>
+
+// Callendar-Van Dusen coefficients for a standard platinum RTD (IEC 60751)
+#define RTD_CVD_A                     3.9083e-3
+#define RTD_CVD_B                     -5.775e-7
+#define RTD_CVD_C                     -4.183e-12
+
+#define RTD_CODE_RANGE                32768   // 15 bit ratio code from max31865::ReadRTD()
+
+// RTD code -> temperature (0.01 degC) interpolation table, built at compile time.
+// One entry every (1 << SHIFT) codes: SHIFT = 7 -> 257 entries (1 KB),
+// SHIFT = 9 -> 65 entries for flash constrained builds.
+// Declare it constexpr so the table ends up in flash:
+//     constexpr rtd_table<> table(430.0, 100.0);
+template <int SHIFT = 7>
+class rtd_table {
+    public:
+
+    static const int SIZE = (RTD_CODE_RANGE >> SHIFT) + 1;
+
+    constexpr rtd_table(double rref, double r0, double a = RTD_CVD_A, double b = RTD_CVD_B, double c = RTD_CVD_C) : table()
+    {
+        for (int i = 0; i < SIZE; i++)
+        {
+            double r = rref * (double)(i << SHIFT) / RTD_CODE_RANGE;
+            table[i] = Round(Solve(r / r0, a, b, c) * 100.0);
+        }
+    }
+
+    // integer only: one table lookup and one linear interpolation
+    int32_t CentiDegrees(int code) const
+    {
+        int i = code >> SHIFT;
+        int32_t t = table[i];
+        return t + (((table[i + 1] - t) * (code & ((1 << SHIFT) - 1))) >> SHIFT);
+    }
+
+    // exact Callendar-Van Dusen temperature for a resistance ratio R/R0 (reference for accuracy checks)
+    static constexpr double Solve(double ratio, double a, double b, double c)
+    {
+        // Newton iterations from the linear estimate, the C term only applies below 0 degC
+        double t = (ratio - 1.0) / a;
+        for (int n = 0; n < 20; n++)
+        {
+            double f = 1.0 + a * t + b * t * t - ratio;
+            double df = a + 2.0 * b * t;
+            if (t < 0)
+            {
+                f += c * (t - 100.0) * t * t * t;
+                df += c * (4.0 * t * t * t - 300.0 * t * t);
+            }
+            t -= f / df;
+        }
+        return t;
+    }
+
+    private:
+    int32_t table[SIZE];
+
+    static constexpr int32_t Round(double x)
+    {
+        return x >= 0 ? (int32_t)(x + 0.5) : -(int32_t)(-x + 0.5);
+    }
+};
+
+#endif
@@ -1,17 +1,81 @@
 #include "mbed.h"
 #include "scd30.h"
+#include "crc8.h"
 
 //-----------------------------------------------------------------------------
 // Constructor 
 
-scd30::scd30(PinName sda, PinName scl, int i2cFrequency)  : _i2c(sda, scl) {
-        _i2c.frequency(i2cFrequency);
+scd30::scd30(PinName sda, PinName scl, int i2cFrequency) {
+        _ownI2c = new mbed_i2c_transport(sda, scl, i2cFrequency);
+        _i2c = _ownI2c;
+        init();
+}
+
+scd30::scd30(i2c_transport &bus) : _i2c(&bus), _ownI2c(NULL) {
+        init();
+}
+
+void scd30::init() {
+        _last.co2 = _last.temp = _last.hum = 0;
+        _last.status = SCDnoERROR;
+        _transactions = 0;
+        _samples = 0;
+#if DEVICE_I2C_ASYNCH
+        asyncHead = 0;
+        asyncCount = 0;
+        asyncActive = false;
+        _queue = NULL;
+        _rdy = NULL;
+        _sampling = false;
+        _reading = false;
+        _timerId = 0;
+#endif
 }
 
 //-----------------------------------------------------------------------------
 // Destructor
 
 scd30::~scd30() {
+#if DEVICE_I2C_ASYNCH
+        scd30::stopSampling();
+        delete _rdy;
+#endif
+        delete _ownI2c;
+}
+
+//-----------------------------------------------------------------------------
+// Every blocking transaction goes through here, for the counters
+
+int scd30::busWrite(int len)
+{
+    _transactions++;
+    uint32_t start = _stats.Start();
+    int res = _i2c->write(SCD30_I2C_ADDR, i2cBuff, len, false);
+    _stats.Stop(start, res ? SCDnoAckERROR : SCDnoERROR);
+    return res;
+}
+
+int scd30::busRead(int len)
+{
+    _transactions++;
+    uint32_t start = _stats.Start();
+    int res = _i2c->read(SCD30_I2C_ADDR | 1, i2cBuff, len, false);
+    _stats.Stop(start, res ? SCDnoAckERROR : SCDnoERROR);
+    return res;
+}
+
+uint8_t scd30::countCrc(uint8_t res)
+{
+    // CRC failures are only known after the transfer, count them by word
+    if(res >= SCDcrcERROR && res <= SCDcrcERRORv6) _stats.Result(res);
+    return res;
+}
+
+void scd30::resetStats()
+{
+    _transactions = 0;
+    _samples = 0;
+    _stats.Reset();
 }
 
 //-----------------------------------------------------------------------------
@@ -25,7 +89,7 @@ uint8_t scd30::startMeasurement(uint16_t baro)
     i2cBuff[2] = baro >> 8;
     i2cBuff[3] = baro & 255;
     i2cBuff[4] = scd30::calcCrc2b(baro);
-    int res = _i2c.write(SCD30_I2C_ADDR, i2cBuff, 5, false);
+    int res = scd30::busWrite(5);
     if(res) return SCDnoAckERROR;
     return SCDnoERROR;
 }
@@ -37,7 +101,7 @@ uint8_t scd30::stopMeasurement()
 {
     i2cBuff[0] = SCD30_CMMD_STOP_CONT_MEAS >> 8;
     i2cBuff[1] = SCD30_CMMD_STOP_CONT_MEAS & 255;
-    int res = _i2c.write(SCD30_I2C_ADDR, i2cBuff, 2, false);
+    int res = scd30::busWrite(2);
     if(res) return SCDnoAckERROR;
     return SCDnoERROR;
 }
@@ -52,7 +116,7 @@ uint8_t scd30::setMeasInterval(uint16_t mi)
     i2cBuff[2] = mi >> 8;
     i2cBuff[3] = mi & 255;
     i2cBuff[4] = scd30::calcCrc2b(mi);
-    int res = _i2c.write(SCD30_I2C_ADDR, i2cBuff, 5, false);
+    int res = scd30::busWrite(5);
     if(res) return SCDnoAckERROR;
     return SCDnoERROR;
 }
@@ -64,17 +128,12 @@ uint8_t scd30::getReadyStatus()
 {
     i2cBuff[0] = SCD30_CMMD_GET_READY_STAT >> 8;
     i2cBuff[1] = SCD30_CMMD_GET_READY_STAT & 255;
-    int res = _i2c.write(SCD30_I2C_ADDR, i2cBuff, 2, false);
+    int res = scd30::busWrite(2);
     if(res) return SCDnoAckERROR;
     
-    _i2c.read(SCD30_I2C_ADDR | 1, i2cBuff, 3, false);
-    uint16_t stat = (i2cBuff[0] << 8) | i2cBuff[1];
-    scdSTR.ready = stat;
-    uint8_t dat = scd30::checkCrc2b(stat, i2cBuff[2]);
-    
-    if(dat == SCDcrcERROR) return SCDcrcERRORv1;
-    if(dat == SCDisReady) return SCDisReady;
-    return SCDnoERROR;
+    res = scd30::busRead(3);
+    if(res) return SCDnoAckERROR;
+    return scd30::countCrc(scd30::decodeReady(i2cBuff));
 }
 
 //-----------------------------------------------------------------------------
@@ -84,52 +143,115 @@ uint8_t scd30::readMeasurement()
 {
     i2cBuff[0] = SCD30_CMMD_READ_MEAS >> 8;
     i2cBuff[1] = SCD30_CMMD_READ_MEAS & 255;
-    int res = _i2c.write(SCD30_I2C_ADDR, i2cBuff, 2, false);
+    int res = scd30::busWrite(2);
     if(res) return SCDnoAckERROR;
     
-    _i2c.read(SCD30_I2C_ADDR | 1, i2cBuff, 18, false);
+    res = scd30::busRead(SCD30_MEAS_FRAME_SIZE);
+    if(res) return SCDnoAckERROR;
+    return scd30::countCrc(scd30::decodeMeasurement(i2cBuff));
+}
+
+scd30::Measurement scd30::getMeasurement()
+{
+    return scd30::measurementResult(scd30::readMeasurement());
+}
+
+//-----------------------------------------------------------------------------
+// Result of a read: the decoded values, or 0 with the error (no stale values
+// of an earlier read after a NACK)
+
+scd30::Measurement scd30::measurementResult(uint8_t res)
+{
+    Measurement m = _last;
+    if(res != SCDnoERROR) {
+        m.co2 = m.temp = m.hum = 0;
+        m.status = res;
+    }
+    return m;
+}
+
+//-----------------------------------------------------------------------------
+// Decode replies, shared by the blocking and the async paths
+
+uint8_t scd30::decodeReady(const char *buff)
+{
+    uint16_t stat = ((uint8_t)buff[0] << 8) | (uint8_t)buff[1];
+    scdSTR.ready = stat;
+    uint8_t dat = scd30::checkCrc2b(stat, (uint8_t)buff[2]);
     
-    uint16_t stat = (i2cBuff[0] << 8) | i2cBuff[1];
-    scdSTR.co2m = stat;
-    uint8_t dat = scd30::checkCrc2b(stat, i2cBuff[2]);
     if(dat == SCDcrcERROR) return SCDcrcERRORv1;
+    if(dat == SCDisReady) return SCDisReady;
+    return SCDnoERROR;
+}
+
+uint8_t scd30::decodeMeasurement(const char *buff)
+{
+    const uint8_t *frame = (const uint8_t *)buff;
+    _last = scd30::decodeFrame(frame);
+    if(_last.status != SCDnoERROR) return _last.status;
+    _samples++;
     
-    stat = (i2cBuff[3] << 8) | i2cBuff[4];
-    scdSTR.co2l = stat;
-    dat = scd30::checkCrc2b(stat, i2cBuff[5]);
-    if(dat == SCDcrcERROR) return SCDcrcERRORv2;
-    
-    stat = (i2cBuff[6] << 8) | i2cBuff[7];
-    scdSTR.tempm = stat;
-    dat = scd30::checkCrc2b(stat, i2cBuff[8]);
-    if(dat == SCDcrcERROR) return SCDcrcERRORv3;
-    
-    stat = (i2cBuff[9] << 8) | i2cBuff[10];
-    scdSTR.templ = stat;
-    dat = scd30::checkCrc2b(stat, i2cBuff[11]);
-    if(dat == SCDcrcERROR) return SCDcrcERRORv4;
-    
-    stat = (i2cBuff[12] << 8) | i2cBuff[13];
-    scdSTR.humm = stat;
-    dat = scd30::checkCrc2b(stat, i2cBuff[14]);
-    if(dat == SCDcrcERROR) return SCDcrcERRORv5;
-    
-    stat = (i2cBuff[15] << 8) | i2cBuff[16];
-    scdSTR.huml = stat;
-    dat = scd30::checkCrc2b(stat, i2cBuff[17]);
-    if(dat == SCDcrcERROR) return SCDcrcERRORv6;
-    
-    scdSTR.co2i = (scdSTR.co2m << 16) | scdSTR.co2l ;
-    scdSTR.tempi = (scdSTR.tempm << 16) | scdSTR.templ ;
-    scdSTR.humi = (scdSTR.humm << 16) | scdSTR.huml ;
-    
-    scdSTR.co2f = *(float*)&scdSTR.co2i;
-    scdSTR.tempf = *(float*)&scdSTR.tempi;
-    scdSTR.humf = *(float*)&scdSTR.humi;
+    // compatibility copy for the scdSTR users
+    scdSTR.co2i = readFloatBits(frame);
+    scdSTR.tempi = readFloatBits(frame + 6);
+    scdSTR.humi = readFloatBits(frame + 12);
+    scdSTR.co2m = scdSTR.co2i >> 16;
+    scdSTR.co2l = scdSTR.co2i & 0xFFFF;
+    scdSTR.tempm = scdSTR.tempi >> 16;
+    scdSTR.templ = scdSTR.tempi & 0xFFFF;
+    scdSTR.humm = scdSTR.humi >> 16;
+    scdSTR.huml = scdSTR.humi & 0xFFFF;
+    scdSTR.co2f = _last.co2;
+    scdSTR.tempf = _last.temp;
+    scdSTR.humf = _last.hum;
     
     return SCDnoERROR;
 }
 
+//-----------------------------------------------------------------------------
+// Typed decode: big-endian words to float through memcpy, no pointer casts
+
+uint32_t scd30::readFloatBits(const uint8_t *p)
+{
+    // two words of MSB, LSB, CRC
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[3] << 8) | p[4];
+}
+
+float scd30::readFloat(const uint8_t *p)
+{
+    uint32_t bits = readFloatBits(p);
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+scd30::Measurement scd30::decodeFrame(const uint8_t *frame)
+{
+    Measurement m;
+    uint8_t bad = scd30::verifyFrame(frame, 6);
+    if(bad) {
+        m.co2 = m.temp = m.hum = 0;
+        m.status = SCDcrcERRORv1 + bad - 1;
+        return m;
+    }
+    m.co2 = readFloat(frame);
+    m.temp = readFloat(frame + 6);
+    m.hum = readFloat(frame + 12);
+    m.status = SCDnoERROR;
+    return m;
+}
+
+size_t scd30::decodeFrames(const uint8_t *frames, size_t count, Measurement *out)
+{
+    size_t good = 0;
+    for(size_t i = 0; i < count; i++) {
+        out[i] = scd30::decodeFrame(frames);
+        if(out[i].status == SCDnoERROR) good++;
+        frames += SCD30_MEAS_FRAME_SIZE;
+    }
+    return good;
+}
+
 //-----------------------------------------------------------------------------
 // Change the ambient temperature (in 0.01C), 
 //   i.e. 0x1F4 = 500 = 5.00C, CRC = 0x33
@@ -141,7 +263,7 @@ uint8_t scd30::setTemperatureOffs(uint16_t temp)
     i2cBuff[2] = temp >> 8;
     i2cBuff[3] = temp & 255;
     i2cBuff[4] = scd30::calcCrc2b(temp);
-    int res = _i2c.write(SCD30_I2C_ADDR, i2cBuff, 5, false);
+    int res = scd30::busWrite(5);
     if(res) return SCDnoAckERROR;
     return SCDnoERROR;
 }
@@ -156,7 +278,7 @@ uint8_t scd30::setAltitudeComp(uint16_t alt)
     i2cBuff[2] = alt >> 8;
     i2cBuff[3] = alt & 255;
     i2cBuff[4] = scd30::calcCrc2b(alt);
-    int res = _i2c.write(SCD30_I2C_ADDR, i2cBuff, 5, false);
+    int res = scd30::busWrite(5);
     if(res) return SCDnoAckERROR;
     return SCDnoERROR;
 }
@@ -168,7 +290,7 @@ uint8_t scd30::softReset()
 {
     i2cBuff[0] = SCD30_CMMD_SOFT_RESET >> 8;
     i2cBuff[1] = SCD30_CMMD_SOFT_RESET & 255;
-    int res = _i2c.write(SCD30_I2C_ADDR, i2cBuff, 2, false);
+    int res = scd30::busWrite(2);
     if(res) return SCDnoAckERROR;
     return SCDnoERROR;
 }
@@ -178,26 +300,25 @@ uint8_t scd30::softReset()
 
 uint8_t scd30::calcCrc2b(uint16_t seed)
 {
-  uint8_t bit;                  // bit mask
-  uint8_t crc = SCD30_CRC_INIT; // calculated checksum
-  
-  // calculates 8-Bit checksum with given polynomial
+    uint8_t crc = SCD30_CRC_INIT;
+    crc = crc8_31.update(crc, seed >> 8);
+    crc = crc8_31.update(crc, seed & 255);
+    return crc;
+}
 
-    crc ^= (seed >> 8) & 255;
-    for(bit = 8; bit > 0; --bit)
-    {
-      if(crc & 0x80) crc = (crc << 1) ^ SCD30_POLYNOMIAL;
-      else           crc = (crc << 1);
-    }
+//-----------------------------------------------------------------------------
+// Check every 3 byte word (MSB, LSB, CRC) of a read buffer in one pass
+//   returns 0 if all ok, else the number (1..words) of the first bad word
 
-    crc ^= seed & 255;
-    for(bit = 8; bit > 0; --bit)
-    {
-      if(crc & 0x80) crc = (crc << 1) ^ SCD30_POLYNOMIAL;
-      else           crc = (crc << 1);
+uint8_t scd30::verifyFrame(const uint8_t *buff, size_t words)
+{
+    for(size_t i = 0; i < words; i++) {
+        uint8_t crc = crc8_31.update(SCD30_CRC_INIT, buff[0]);
+        crc = crc8_31.update(crc, buff[1]);
+        if(crc != buff[2]) return i + 1;
+        buff += 3;
     }
-    
-  return crc;
+    return 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -221,7 +342,7 @@ uint8_t scd30::startOneMeasurement(uint16_t baro)
     i2cBuff[2] = baro >> 8;
     i2cBuff[3] = baro & 255;
     i2cBuff[4] = scd30::calcCrc2b(baro);
-    int res = _i2c.write(SCD30_I2C_ADDR, i2cBuff, 5, false);
+    int res = scd30::busWrite(5);
     if(res) return SCDnoAckERROR;
     return SCDnoERROR;
 }
@@ -233,13 +354,19 @@ uint8_t scd30::getArticleCode()
 {
     i2cBuff[0] = SCD30_CMMD_READ_ARTICLECODE >> 8;
     i2cBuff[1] = SCD30_CMMD_READ_ARTICLECODE & 255;
-    int res = _i2c.write(SCD30_I2C_ADDR, i2cBuff, 2, false);
+    int res = scd30::busWrite(2);
     if(res) return SCDnoAckERROR;
     
-    _i2c.read(SCD30_I2C_ADDR | 1, i2cBuff, 3, false);
-    uint16_t stat = (i2cBuff[0] << 8) | i2cBuff[1];
+    res = scd30::busRead(3);
+    if(res) return SCDnoAckERROR;
+    return scd30::countCrc(scd30::decodeArticleCode(i2cBuff));
+}
+
+uint8_t scd30::decodeArticleCode(const char *buff)
+{
+    uint16_t stat = ((uint8_t)buff[0] << 8) | (uint8_t)buff[1];
     scdSTR.acode = stat;
-    uint8_t dat = scd30::checkCrc2b(stat, i2cBuff[2]);
+    uint8_t dat = scd30::checkCrc2b(stat, (uint8_t)buff[2]);
     
     if(dat == SCDcrcERROR) return SCDcrcERRORv1;
     return SCDnoERROR;
@@ -252,20 +379,28 @@ uint8_t scd30::getSerialNumber()
 {
     i2cBuff[0] = SCD30_CMMD_READ_SERIALNBR >> 8;
     i2cBuff[1] = SCD30_CMMD_READ_SERIALNBR & 255;
-    int res = _i2c.write(SCD30_I2C_ADDR, i2cBuff, 2, false);
+    int res = scd30::busWrite(2);
     if(res) return SCDnoAckERROR;
     
     int i = 0;
-    for(i = 0; i < sizeof(scdSTR.sn); i++) scdSTR.sn[i] = 0;
-    for(i = 0; i < sizeof(i2cBuff); i++) i2cBuff[i] = 0;
+    for(i = 0; i < (int)sizeof(i2cBuff); i++) i2cBuff[i] = 0;
+    
+    res = scd30::busRead(SCD30_SN_SIZE);
+    if(res) return SCDnoAckERROR;
+    return scd30::countCrc(scd30::decodeSerialNumber(i2cBuff));
+}
+
+uint8_t scd30::decodeSerialNumber(const char *buff)
+{
+    int i = 0;
+    for(i = 0; i < (int)sizeof(scdSTR.sn); i++) scdSTR.sn[i] = 0;
     
-    _i2c.read(SCD30_I2C_ADDR | 1, i2cBuff, SCD30_SN_SIZE, false);
     int t = 0;
     for(i = 0; i < SCD30_SN_SIZE; i +=3) {
-        uint16_t stat = (i2cBuff[i] << 8) | i2cBuff[i + 1];
+        uint16_t stat = ((uint8_t)buff[i] << 8) | (uint8_t)buff[i + 1];
         scdSTR.sn[i - t] = stat >> 8;
         scdSTR.sn[i - t + 1] = stat & 255;
-        uint8_t dat = scd30::checkCrc2b(stat, i2cBuff[i + 2]);
+        uint8_t dat = scd30::checkCrc2b(stat, (uint8_t)buff[i + 2]);
         t++;
         if(dat == SCDcrcERROR) return SCDcrcERRORv1;
         if(stat == 0) break;
@@ -273,3 +408,301 @@ uint8_t scd30::getSerialNumber()
 
     return SCDnoERROR;
 }
+
+#if DEVICE_I2C_ASYNCH
+//-----------------------------------------------------------------------------
+// Async (split-phase) transactions
+//
+// Commands are queued and run back to back on the bus. Each one is a command
+// write, then, for commands with a reply, a data read SCD30_ASYNC_READ_DELAY ms
+// later. The I2C interrupt only posts the next step to the EventQueue, so the
+// phases, the decoding and the user callback all run in the queue's thread.
+
+void scd30::attachQueue(EventQueue *queue)
+{
+    _queue = queue;
+}
+
+//-----------------------------------------------------------------------------
+// Queue a command without argument
+
+uint8_t scd30::submit(uint16_t cmd, scdCallback cb)
+{
+    return scd30::submitRequest(cmd, 0, false, cb);
+}
+
+//-----------------------------------------------------------------------------
+// Queue a command with a 16 bit argument
+
+uint8_t scd30::submit(uint16_t cmd, uint16_t arg, scdCallback cb)
+{
+    return scd30::submitRequest(cmd, arg, true, cb);
+}
+
+uint8_t scd30::getReadyStatusAsync(scdCallback cb)
+{
+    return scd30::submit(SCD30_CMMD_GET_READY_STAT, cb);
+}
+
+uint8_t scd30::readMeasurementAsync(scdCallback cb)
+{
+    return scd30::submit(SCD30_CMMD_READ_MEAS, cb);
+}
+
+bool scd30::asyncBusy()
+{
+    return asyncActive || asyncCount;
+}
+
+uint8_t scd30::submitRequest(uint16_t cmd, uint16_t arg, bool hasArg, scdCallback cb)
+{
+    if(_queue == NULL) return SCDnoAckERROR;
+    
+    core_util_critical_section_enter();
+    if(asyncCount == SCD30_ASYNC_QUEUE_SIZE) {
+        core_util_critical_section_exit();
+        return SCDqueueFullERROR;
+    }
+    scdRequest &req = asyncQueue[(asyncHead + asyncCount) % SCD30_ASYNC_QUEUE_SIZE];
+    req.cmd = cmd;
+    req.arg = arg;
+    req.hasArg = hasArg;
+    req.cb = cb;
+    asyncCount++;
+    bool idle = !asyncActive;
+    if(idle) asyncActive = true;
+    core_util_critical_section_exit();
+    
+    if(idle) _queue->call(callback(this, &scd30::asyncStart));
+    return SCDnoERROR;
+}
+
+//-----------------------------------------------------------------------------
+// Number of reply bytes for a command (0 = write only)
+
+int scd30::replyLength(uint16_t cmd)
+{
+    switch(cmd) {
+        case SCD30_CMMD_GET_READY_STAT:     return 3;
+        case SCD30_CMMD_READ_MEAS:          return 18;
+        case SCD30_CMMD_READ_ARTICLECODE:   return 3;
+        case SCD30_CMMD_READ_SERIALNBR:     return SCD30_SN_SIZE;
+        default:                            return 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Phase 1: write the command at the head of the queue
+
+void scd30::asyncStart()
+{
+    scdRequest &req = asyncQueue[asyncHead];
+    int len = 2;
+    asyncTx[0] = req.cmd >> 8;
+    asyncTx[1] = req.cmd & 255;
+    if(req.hasArg) {
+        asyncTx[2] = req.arg >> 8;
+        asyncTx[3] = req.arg & 255;
+        asyncTx[4] = scd30::calcCrc2b(req.arg);
+        len = 5;
+    }
+    asyncReading = false;
+    _transactions++;
+    asyncT0 = _stats.Start();
+    int res = _i2c->transfer(SCD30_I2C_ADDR, asyncTx, len, NULL, 0,
+                            callback(this, &scd30::asyncIrq), I2C_EVENT_ALL, false);
+    if(res) scd30::asyncFinish(SCDnoAckERROR);
+}
+
+//-----------------------------------------------------------------------------
+// Phase 2: read the reply
+
+void scd30::asyncRead()
+{
+    asyncReading = true;
+    _transactions++;
+    asyncT0 = _stats.Start();
+    int res = _i2c->transfer(SCD30_I2C_ADDR | 1, NULL, 0, asyncRx, asyncRxLen,
+                            callback(this, &scd30::asyncIrq), I2C_EVENT_ALL, false);
+    if(res) scd30::asyncFinish(SCDnoAckERROR);
+}
+
+//-----------------------------------------------------------------------------
+// I2C interrupt, defer the work to the queue
+
+void scd30::asyncIrq(int event)
+{
+    asyncTicks = _stats.Start() - asyncT0;
+    _queue->call(callback(this, &scd30::asyncStep), event);
+}
+
+void scd30::asyncStep(int event)
+{
+    bool nack = event & (I2C_EVENT_ERROR | I2C_EVENT_ERROR_NO_SLAVE | I2C_EVENT_TRANSFER_EARLY_NACK);
+    _stats.Record(asyncTicks, nack ? SCDnoAckERROR : SCDnoERROR);
+    if(event & (I2C_EVENT_ERROR | I2C_EVENT_ERROR_NO_SLAVE | I2C_EVENT_TRANSFER_EARLY_NACK)) {
+        scd30::asyncFinish(SCDnoAckERROR);
+        return;
+    }
+    
+    uint16_t cmd = asyncQueue[asyncHead].cmd;
+    if(!asyncReading) {
+        asyncRxLen = scd30::replyLength(cmd);
+        if(asyncRxLen) {
+            _queue->call_in(SCD30_ASYNC_READ_DELAY, callback(this, &scd30::asyncRead));
+            return;
+        }
+        scd30::asyncFinish(SCDnoERROR);
+        return;
+    }
+    
+    uint8_t res = SCDnoERROR;
+    switch(cmd) {
+        case SCD30_CMMD_GET_READY_STAT:     res = scd30::decodeReady(asyncRx); break;
+        case SCD30_CMMD_READ_MEAS:          res = scd30::decodeMeasurement(asyncRx); break;
+        case SCD30_CMMD_READ_ARTICLECODE:   res = scd30::decodeArticleCode(asyncRx); break;
+        case SCD30_CMMD_READ_SERIALNBR:     res = scd30::decodeSerialNumber(asyncRx); break;
+    }
+    scd30::asyncFinish(scd30::countCrc(res));
+}
+
+//-----------------------------------------------------------------------------
+// Pop the finished command, start the next one, then report
+
+void scd30::asyncFinish(uint8_t res)
+{
+    core_util_critical_section_enter();
+    scdRequest req = asyncQueue[asyncHead];
+    asyncHead = (asyncHead + 1) % SCD30_ASYNC_QUEUE_SIZE;
+    asyncCount--;
+    bool more = asyncCount != 0;
+    asyncActive = more;
+    core_util_critical_section_exit();
+    
+    if(more) scd30::asyncStart();
+    if(req.cb) req.cb(req.cmd, res);
+}
+
+//-----------------------------------------------------------------------------
+// Sampling without periodic polling
+//
+// RDY pin: edge -> read. Predictive poller: sleep until SCD30_POLL_LEAD_MS
+// before the expected sample, poll the ready status every SCD30_POLL_RETRY_MS,
+// read, then sleep again from the time the sample was seen. The lead grows
+// when the first poll is already ready (maybe late) and shrinks when more
+// than two polls were needed (too early), so a steady state costs two status
+// polls and one read per sample.
+
+uint8_t scd30::startSampling(uint16_t intervalS, scdSampleCallback cb, PinName rdy)
+{
+    if(_queue == NULL) return SCDnoAckERROR;
+    
+    scd30::stopSampling();
+    _sampleCb = cb;
+    _intervalMs = intervalS * 1000;
+    _leadMs = SCD30_POLL_LEAD_MS;
+    _polls = 0;
+    _reading = false;
+    _sampling = true;
+    
+    if(rdy != NC) {
+        if(_rdy == NULL) _rdy = new InterruptIn(rdy);
+        _rdy->rise(callback(this, &scd30::rdyIrq));
+        // a sample may already be waiting, the edge is gone
+        _timerId = _queue->call(callback(this, &scd30::rdyCheck));
+    } else {
+        // phase unknown, start polling now
+        _timerId = _queue->call(callback(this, &scd30::samplePoll));
+    }
+    return SCDnoERROR;
+}
+
+void scd30::stopSampling()
+{
+    _sampling = false;
+    if(_timerId) _queue->cancel(_timerId);
+    _timerId = 0;
+    if(_rdy) _rdy->rise(Callback<void()>());
+}
+
+void scd30::samplePoll()
+{
+    _timerId = 0;
+    if(!_sampling) return;
+    _polls++;
+    if(scd30::getReadyStatusAsync(callback(this, &scd30::samplePollDone)) != SCDnoERROR) {
+        _timerId = _queue->call_in(SCD30_POLL_RETRY_MS, callback(this, &scd30::samplePoll));
+    }
+}
+
+void scd30::samplePollDone(uint16_t cmd, uint8_t res)
+{
+    if(!_sampling) return;
+    if(res != SCDnoERROR || scdSTR.ready != SCDisReady) {
+        _timerId = _queue->call_in(SCD30_POLL_RETRY_MS, callback(this, &scd30::samplePoll));
+        return;
+    }
+    
+    // adapt the lead to where the sample was found
+    if(_polls <= 1) {
+        _leadMs += SCD30_POLL_RETRY_MS;
+        if(_leadMs > _intervalMs / 2) _leadMs = _intervalMs / 2;
+    } else if(_polls > 2) {
+        _leadMs -= SCD30_POLL_RETRY_MS;
+        if(_leadMs < SCD30_POLL_RETRY_MS) _leadMs = SCD30_POLL_RETRY_MS;
+    }
+    _polls = 0;
+    _readyTick = _queue->tick();
+    scd30::sampleRead();
+}
+
+void scd30::sampleRead()
+{
+    _timerId = 0;
+    if(_reading) return;
+    _reading = true;
+    if(scd30::readMeasurementAsync(callback(this, &scd30::sampleDone)) != SCDnoERROR) {
+        _reading = false;
+        _timerId = _queue->call_in(SCD30_POLL_RETRY_MS, callback(this, &scd30::sampleRead));
+    }
+}
+
+void scd30::sampleDone(uint16_t cmd, uint8_t res)
+{
+    _reading = false;
+    if(!_sampling) return;
+    Measurement m = scd30::measurementResult(res);
+    if(_sampleCb) _sampleCb(m);
+    if(!_sampling) return;   // the callback stopped the sampling (sensor restart)
+    
+    if(_rdy) {
+        // watchdog in case an edge is missed, the pin stays high until the read
+        _timerId = _queue->call_in(SCD30_RDY_TIMEOUT * _intervalMs, callback(this, &scd30::rdyCheck));
+        return;
+    }
+    
+    int delay = _intervalMs - _leadMs - (int)(_queue->tick() - _readyTick);
+    if(delay < 0) delay = 0;
+    _timerId = _queue->call_in(delay, callback(this, &scd30::samplePoll));
+}
+
+//-----------------------------------------------------------------------------
+// RDY pin
+
+void scd30::rdyIrq()
+{
+    _queue->call(callback(this, &scd30::rdyCheck));
+}
+
+void scd30::rdyCheck()
+{
+    if(!_sampling) return;
+    if(_timerId) _queue->cancel(_timerId);
+    _timerId = 0;
+    if(_rdy->read()) {
+        scd30::sampleRead();
+    } else {
+        _timerId = _queue->call_in(SCD30_RDY_TIMEOUT * _intervalMs, callback(this, &scd30::rdyCheck));
+    }
+}
+#endif
@@ -1,6 +1,9 @@
 #ifndef SCD30_H
 #define SCD30_H
 
+#include "bus_transport.h"
+#include "bus_stats.h"
+
 #define SCD30_I2C_ADDR                  0xc2
 
 #define SCD30_CMMD_STRT_CONT_MEAS       0x0010
@@ -22,6 +25,13 @@
 #define SCD30_CRC_INIT                  0xff
 
 #define SCD30_SN_SIZE                   33      //size of the s/n ascii string + CRC values
+#define SCD30_MEAS_FRAME_SIZE           18      //READ_MEAS reply: 6 words of MSB, LSB, CRC
+
+#define SCD30_ASYNC_QUEUE_SIZE          4       //async commands waiting for the bus
+#define SCD30_ASYNC_READ_DELAY          3       //ms between command write and data read
+#define SCD30_POLL_LEAD_MS              200     //first ready status poll this long before the expected sample
+#define SCD30_POLL_RETRY_MS             100     //not ready yet: poll again after
+#define SCD30_RDY_TIMEOUT               2       //RDY mode: check the pin level after this many intervals without edge
 
     /** Create SCD30 controller class
      *
@@ -43,10 +53,23 @@ public:
         SCDcrcERRORv4,      //CRC error on value 4
         SCDcrcERRORv5,      //CRC error on value 5
         SCDcrcERRORv6,      //CRC error on value 6
+        SCDqueueFullERROR,  //async command queue full
+    };
+    
+    /**
+     * One measurement, returned by value (no shared state to poll)
+     *
+     */
+    struct Measurement {
+        float co2;              /**< CO2 concentration (ppm) */
+        float temp;             /**< Temp (degC) */
+        float hum;              /**< Hum (%RH) */
+        uint8_t status;         /**< enum SCDerror, values are 0 unless SCDnoERROR */
     };
     
     /**
      * Structure to access SCD30's raw and finished data
+     * Kept for compatibility, filled by readMeasurement() like before
      *
      */    
     struct scdSTRuct {
@@ -81,6 +104,13 @@ public:
      */
      scd30(PinName sda, PinName scl, int i2cFrequency);
      
+    /** Create a SCD30 object on an existing I2C transport
+     * @param bus - recorded, replayed or shared I2C transport
+     *
+     * @return none
+     */
+     scd30(i2c_transport &bus);
+     
     /** Destructor
      *
      * @param --none--
@@ -131,6 +161,40 @@ public:
      */
     uint8_t readMeasurement();
     
+    /** Get all environmental parameters (CO2, Temp and Hum) 
+     *
+     * @param --none-
+     *
+     * @return Measurement, status = enum SCDerror
+     */
+    Measurement getMeasurement();
+    
+    /** Last measurement decoded by readMeasurement(), getMeasurement() or readMeasurementAsync()
+     *
+     * @param --none-
+     *
+     * @return Measurement, status = enum SCDerror
+     */
+    Measurement lastMeasurement() const { return _last; }
+    
+    /** Decode one READ_MEAS reply
+     *
+     * @param SCD30_MEAS_FRAME_SIZE raw bytes
+     *
+     * @return Measurement, status = enum SCDerror
+     */
+    static Measurement decodeFrame(const uint8_t *frame);
+    
+    /** Decode consecutive READ_MEAS replies (log or capture buffer)
+     *
+     * @param count * SCD30_MEAS_FRAME_SIZE raw bytes
+     * @param number of replies
+     * @param count Measurement results, one per reply
+     *
+     * @return number of replies with status SCDnoERROR
+     */
+    static size_t decodeFrames(const uint8_t *frames, size_t count, Measurement *out);
+    
     /** Set Temperature offset
      *
      * @param Temperature offset (value in 0.01 degrees C)
@@ -172,6 +236,15 @@ public:
      */
     uint8_t checkCrc2b(uint16_t seed, uint8_t crcIn);
     
+    /** Check the CRC of every word in a read buffer
+     *
+     * @param pointer to the raw buffer (MSB, LSB, CRC per word)
+     * @param number of 3 byte words in the buffer
+     *
+     * @return 0 if all CRCs match, else number (1..words) of the first bad word
+     */
+    static uint8_t verifyFrame(const uint8_t *buff, size_t words);
+    
     /** Start a Single-Measurement 
      *
      * @param Barometer reading (in mB) or 0x0000
@@ -197,12 +270,210 @@ public:
      * @return enum SCDerror
      */
     uint8_t getSerialNumber();
+    
+    /** Bus transactions (I2C writes and reads) since resetStats()
+     *
+     * @param --none--
+     *
+     * @return number of transactions
+     */
+    uint32_t busTransactions() const { return _transactions; }
+    
+    /** Measurements decoded since resetStats()
+     *
+     * @param --none--
+     *
+     * @return number of measurements
+     */
+    uint32_t samplesDelivered() const { return _samples; }
+    
+    /** Bus cost of one measurement, to check what polling costs
+     *
+     * @param --none--
+     *
+     * @return transactions per delivered measurement, 0 before the first one
+     */
+    float transactionsPerSample() const { return _samples ? (float)_transactions / _samples : 0.0f; }
+    
+    /** Clear the transaction and measurement counters
+     *
+     * @param --none--
+     *
+     * @return none
+     */
+    void resetStats();
+    
+    /** Latency histogram and count per enum SCDerror of every transaction,
+     * CRC errors counted per word (SCDcrcERRORv1..v6)
+     *
+     * @param --none--
+     *
+     * @return statistics, empty when built with BUS_STATS=0
+     */
+    const bus_stats &stats() const { return _stats; }
+    
+#if DEVICE_I2C_ASYNCH
+    /** Async completion callback
+     *
+     * @param command code (SCD30_CMMD_...)
+     * @param enum SCDerror
+     * @see decoded values are in scdSTR when it is called
+     */
+    typedef Callback<void(uint16_t, uint8_t)> scdCallback;
+    
+    /** Select the EventQueue the async transactions run on
+     *
+     * @param queue, must be dispatched for the async commands to progress
+     *
+     * @return none
+     */
+    void attachQueue(EventQueue *queue);
+    
+    /** Queue a command without argument, non-blocking
+     *
+     * @param command code (SCD30_CMMD_...)
+     * @param completion callback
+     *
+     * @return enum SCDerror (SCDqueueFullERROR if no room)
+     */
+    uint8_t submit(uint16_t cmd, scdCallback cb);
+    
+    /** Queue a command with a 16 bit argument, non-blocking
+     *
+     * @param command code (SCD30_CMMD_...)
+     * @param argument, CRC is added by the driver
+     * @param completion callback
+     *
+     * @return enum SCDerror (SCDqueueFullERROR if no room)
+     */
+    uint8_t submit(uint16_t cmd, uint16_t arg, scdCallback cb);
+    
+    /** Non-blocking getReadyStatus
+     *
+     * @param completion callback
+     * @see Ready Status result in scdSTR structure
+     *
+     * @return enum SCDerror
+     */
+    uint8_t getReadyStatusAsync(scdCallback cb);
+    
+    /** Non-blocking readMeasurement
+     *
+     * @param completion callback
+     * @see Results in scdSTR structure
+     *
+     * @return enum SCDerror
+     */
+    uint8_t readMeasurementAsync(scdCallback cb);
+    
+    /** Async engine state
+     *
+     * @param --none--
+     *
+     * @return true while commands are queued or on the bus
+     */
+    bool asyncBusy();
+    
+    /** Measurement callback of startSampling()
+     *
+     * @param decoded measurement, status = enum SCDerror
+     */
+    typedef Callback<void(Measurement)> scdSampleCallback;
+    
+    /** Deliver each new measurement without polling every few hundred ms
+     *
+     * With the RDY pin wired, its rising edge starts the read: one read per
+     * sample and no status polling. Without it (NC), the ready status is
+     * polled just before the expected sample time; each sample re-anchors
+     * the prediction and the lead adapts, so the SCD30 clock drift is
+     * followed. The sensor must already measure at this interval
+     * (setMeasInterval() + startMeasurement()), attachQueue() first.
+     *
+     * @param measurement interval (in seconds)
+     * @param called on the queue with each measurement
+     * @param SCD30 RDY pin, or NC to use the predictive poller
+     *
+     * @return enum SCDerror (SCDnoAckERROR without queue)
+     */
+    uint8_t startSampling(uint16_t intervalS, scdSampleCallback cb, PinName rdy = NC);
+    
+    /** Stop the deliveries of startSampling()
+     *
+     * @param --none--
+     *
+     * @return none
+     */
+    void stopSampling();
+#endif
  
 private:
     char i2cBuff[34];
+    Measurement _last;
+    uint32_t _transactions;
+    uint32_t _samples;
+    bus_stats _stats;
+    
+    void init();
+    int busWrite(int len);
+    int busRead(int len);
+    uint8_t countCrc(uint8_t res);
+    uint8_t decodeReady(const char *buff);
+    uint8_t decodeMeasurement(const char *buff);
+    Measurement measurementResult(uint8_t res);
+    static uint32_t readFloatBits(const uint8_t *p);
+    static float readFloat(const uint8_t *p);
+    uint8_t decodeArticleCode(const char *buff);
+    uint8_t decodeSerialNumber(const char *buff);
+    
+#if DEVICE_I2C_ASYNCH
+    struct scdRequest {
+        uint16_t cmd;
+        uint16_t arg;
+        bool hasArg;
+        scdCallback cb;
+    };
+    
+    scdRequest asyncQueue[SCD30_ASYNC_QUEUE_SIZE];
+    uint8_t asyncHead;
+    uint8_t asyncCount;
+    bool asyncActive;
+    bool asyncReading;
+    int asyncRxLen;
+    char asyncTx[5];
+    char asyncRx[SCD30_SN_SIZE];
+    EventQueue *_queue;
+    uint32_t asyncT0;       //stats: start of the transfer on the bus
+    uint32_t asyncTicks;    //stats: transfer duration, measured in the interrupt
+    
+    uint8_t submitRequest(uint16_t cmd, uint16_t arg, bool hasArg, scdCallback cb);
+    static int replyLength(uint16_t cmd);
+    void asyncStart();
+    void asyncRead();
+    void asyncIrq(int event);
+    void asyncStep(int event);
+    void asyncFinish(uint8_t res);
+    
+    scdSampleCallback _sampleCb;
+    InterruptIn *_rdy;
+    bool _sampling;
+    bool _reading;          //measurement read on the bus
+    int _intervalMs;
+    int _leadMs;            //predictive poller: first poll this long before the expected sample
+    int _polls;             //status polls for the sample in progress
+    int _timerId;
+    unsigned _readyTick;
+    
+    void samplePoll();
+    void samplePollDone(uint16_t cmd, uint8_t res);
+    void sampleRead();
+    void sampleDone(uint16_t cmd, uint8_t res);
+    void rdyIrq();
+    void rdyCheck();
+#endif
  
 protected:
-    I2C     _i2c;    
+    i2c_transport *_i2c;
+    mbed_i2c_transport *_ownI2c;    //created by the pin constructor
 
 };    
 #endif
@@ -0,0 +1,97 @@
+#include "serial_tx.h"
+#include <stdarg.h>
+
+//-----------------------------------------------------------------------------
+// Constructor
+
+serial_tx::serial_tx(RawSerial &serial) : _serial(serial) {
+    txActive = false;
+    dropCount = 0;
+    highWaterMark = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Producer side
+
+bool serial_tx::enqueue(uint8_t c)
+{
+    bool ok = ring.push(c);
+    if(!ok) dropCount++;
+    unsigned level = ring.count();
+    if(level > highWaterMark) highWaterMark = level;
+    kick();
+    return ok;
+}
+
+int serial_tx::write(const uint8_t *data, int len)
+{
+    int n = 0;
+    while(n < len && ring.push(data[n])) n++;
+    dropCount += len - n;
+    unsigned level = ring.count();
+    if(level > highWaterMark) highWaterMark = level;
+    kick();
+    return n;
+}
+
+int serial_tx::printf(const char *format, ...)
+{
+    char line[SERIAL_TX_LINE_SIZE];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if(len < 0) return 0;
+    if(len >= (int)sizeof(line)) len = sizeof(line) - 1;
+    return write((const uint8_t *)line, len);
+}
+
+//-----------------------------------------------------------------------------
+// Counters
+
+unsigned serial_tx::drops()
+{
+    return dropCount;
+}
+
+unsigned serial_tx::highWater()
+{
+    return highWaterMark;
+}
+
+void serial_tx::resetStats()
+{
+    dropCount = 0;
+    highWaterMark = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Enable the TX interrupt if it is not running. The interrupt may have just
+// found the ring empty and switched itself off, so test and attach with
+// interrupts masked.
+
+void serial_tx::kick()
+{
+    core_util_critical_section_enter();
+    if(!txActive && !ring.empty()) {
+        txActive = true;
+        _serial.attach(callback(this, &serial_tx::txIrq), SerialBase::TxIrq);
+    }
+    core_util_critical_section_exit();
+}
+
+//-----------------------------------------------------------------------------
+// Consumer side, TX-empty interrupt
+
+void serial_tx::txIrq()
+{
+    uint8_t c;
+    while(_serial.writeable()) {
+        if(!ring.pop(c)) {
+            _serial.attach(Callback<void()>(), SerialBase::TxIrq);
+            txActive = false;
+            return;
+        }
+        _serial.putc(c);
+    }
+}
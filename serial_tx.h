@@ -0,0 +1,74 @@
+#ifndef SERIAL_TX_H
+#define SERIAL_TX_H
+
+#include "mbed.h"
+#include "spsc_ring.h"
+
+#define SERIAL_TX_SIZE                  256     //bytes waiting for the UART, power of two
+#define SERIAL_TX_LINE_SIZE             128     //longest printf() line
+
+    /** Interrupt driven transmit for a RawSerial
+     *
+     * The caller only copies bytes into a lock-free ring, the TX-empty
+     * interrupt shifts them out. Nothing blocks: when the ring is full
+     * the bytes are dropped and counted.
+     *
+     * RawSerial is required, its attach() takes no mutex and can be
+     * called from the interrupt.
+     *
+     */
+class serial_tx {
+
+public:
+    /** Create a transmitter on an existing serial port
+     *
+     * @param serial port, its TX interrupt is owned by this object
+     *
+     * @return none
+     */
+    serial_tx(RawSerial &serial);
+
+    /** Queue one byte, non-blocking
+     *
+     * @param byte to send
+     *
+     * @return false if the ring was full and the byte was dropped
+     */
+    bool enqueue(uint8_t c);
+
+    /** Queue a buffer, non-blocking
+     *
+     * @param bytes to send
+     * @param number of bytes
+     *
+     * @return number of bytes queued, the rest was dropped
+     */
+    int write(const uint8_t *data, int len);
+
+    /** Format a line (at most SERIAL_TX_LINE_SIZE bytes) and queue it
+     *
+     * @return number of bytes queued
+     */
+    int printf(const char *format, ...);
+
+    /** Bytes dropped because the ring was full */
+    unsigned drops();
+
+    /** Highest ring fill level seen, in bytes */
+    unsigned highWater();
+
+    /** Clear the drop and high-water counters */
+    void resetStats();
+
+private:
+    RawSerial &_serial;
+    spsc_ring<uint8_t, SERIAL_TX_SIZE> ring;
+    volatile bool txActive;
+    volatile unsigned dropCount;
+    volatile unsigned highWaterMark;
+
+    void kick();
+    void txIrq();
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SIM_BLOCKDEVICE_H
+#define SIM_BLOCKDEVICE_H
+
+// Host stand-in for the Mbed OS BlockDevice interface
+
+#include <stdint.h>
+
+typedef uint64_t bd_addr_t;
+typedef uint64_t bd_size_t;
+
+enum bd_error {
+    BD_ERROR_OK                 = 0,        // no error
+    BD_ERROR_DEVICE_ERROR       = -4001,    // device specific error
+};
+
+class BlockDevice {
+    public:
+    static BlockDevice *get_default_instance();   // not provided on the host, use FileBlockDevice
+    virtual ~BlockDevice() {}
+    virtual int init() = 0;
+    virtual int deinit() = 0;
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size) = 0;
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size) = 0;
+    virtual int erase(bd_addr_t addr, bd_size_t size) { return 0; }
+    virtual bd_size_t get_read_size() const = 0;
+    virtual bd_size_t get_program_size() const = 0;
+    virtual bd_size_t get_erase_size() const { return get_program_size(); }
+    virtual bd_size_t size() const = 0;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SIM_FILEBLOCKDEVICE_H
+#define SIM_FILEBLOCKDEVICE_H
+
+// BlockDevice backed by a file, to write and read brew_log images on Linux
+
+#include "BlockDevice.h"
+#include <stdio.h>
+#include <string.h>
+
+class FileBlockDevice : public BlockDevice {
+    public:
+    FileBlockDevice(const char *path, bd_size_t size, bd_size_t block = 512) : path(path), file(NULL), total(size), block(block) {}
+
+    virtual int init()
+    {
+        file = fopen(path, "r+b");
+        if (!file)
+        {
+            // new image, erased (0xFF) like flash
+            file = fopen(path, "w+b");
+            if (!file) return -1;
+            char ff[512];
+            memset(ff, 0xFF, sizeof(ff));
+            for (bd_size_t i = 0; i < total; i += sizeof(ff)) fwrite(ff, 1, sizeof(ff), file);
+        }
+        return 0;
+    }
+
+    virtual int deinit()
+    {
+        if (file) fclose(file);
+        file = NULL;
+        return 0;
+    }
+
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        if (!file || addr + size > total) return -1;
+        fseek(file, (long)addr, SEEK_SET);
+        return fread(buffer, 1, size, file) == size ? 0 : -1;
+    }
+
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        if (!file || addr + size > total) return -1;
+        fseek(file, (long)addr, SEEK_SET);
+        return fwrite(buffer, 1, size, file) == size ? 0 : -1;
+    }
+
+    virtual int erase(bd_addr_t addr, bd_size_t size)
+    {
+        if (!file || addr + size > total) return -1;
+        char ff[512];
+        memset(ff, 0xFF, sizeof(ff));
+        fseek(file, (long)addr, SEEK_SET);
+        for (bd_size_t i = 0; i < size; i += sizeof(ff)) fwrite(ff, 1, size - i < sizeof(ff) ? size - i : sizeof(ff), file);
+        return 0;
+    }
+
+    virtual bd_size_t get_read_size() const { return block; }
+    virtual bd_size_t get_program_size() const { return block; }
+    virtual bd_size_t size() const { return total; }
+
+    private:
+    const char *path;
+    FILE *file;
+    bd_size_t total, block;
+};
+
+#endif
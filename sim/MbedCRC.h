@@ -0,0 +1,34 @@
+#ifndef SIM_MBEDCRC_H
+#define SIM_MBEDCRC_H
+
+// Host stand-in for Mbed OS MbedCRC (bitwise, MSB first, initial value all ones)
+
+#include <stdint.h>
+
+enum crc_polynomial {
+    POLY_8BIT_CCITT = 0x07,
+    POLY_16BIT_CCITT = 0x1021,
+    POLY_32BIT_ANSI = 0x04C11DB7,
+};
+
+template <uint32_t polynomial = POLY_32BIT_ANSI, uint8_t width = 32>
+class MbedCRC {
+    public:
+    int32_t compute(const void *buffer, uint32_t size, uint32_t *crc)
+    {
+        const uint8_t *p = (const uint8_t *)buffer;
+        uint32_t top = 1ul << (width - 1);
+        uint32_t mask = width == 32 ? 0xFFFFFFFFul : (1ul << width) - 1;
+        uint32_t c = mask;
+        while (size--)
+        {
+            c ^= (uint32_t)*p++ << (width - 8);
+            for (int b = 0; b < 8; b++) c = (c & top) ? (c << 1) ^ polynomial : (c << 1);
+            c &= mask;
+        }
+        *crc = c;
+        return 0;
+    }
+};
+
+#endif
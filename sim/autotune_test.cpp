@@ -0,0 +1,123 @@
+// relay_autotune check and benchmark (./brew_sim -t autotune):
+//
+//  - a sine fed straight in: Pu is its period and Ku = 4 d / (pi a) exactly
+//  - the tuning rules against their textbook formulas
+//  - closed relay loop on a first order plus dead time plant, where the
+//    ultimate gain and period are known analytically: Pu within 15 %, Ku
+//    within 25 % and below the exact value. The describing function sees a
+//    sine where a lag dominated plant gives a triangle, so it underestimates
+//    Ku; that errs on the safe side (lower gains)
+//  - RAM of the experiment (no sample buffer) and cpu time per Update()
+
+#include "mbed.h"
+#include "autotune.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+int autotune_session(void);
+
+namespace {
+
+const float PI = 3.14159265f;
+const int UPDATES = 1000000;
+const int RUNS = 5;
+
+int failures = 0;
+float sink;
+
+void check(const char *name, bool ok, float value, float expected)
+{
+    printf("%-48s %10.4f  expected %10.4f  %s\n", name, value, expected, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+bool near(float value, float expected, float tolerance)
+{
+    return fabs(value - expected) <= tolerance * fabs(expected);
+}
+
+double now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+int autotune_session(void)
+{
+    failures = 0;
+
+    // open loop sine: period 300 s, amplitude 2 degC around 63, 0.1 s samples
+    relay_autotune sine(1, 0, 0.2f, 4);
+    sine.Start(63, 0);
+    float t = 0;
+    for (; !sine.Done() && t < 5000; t += 0.1f)
+    {
+        sine.Update(63 - 2 * sinf(2 * PI * t / 300), t);
+    }
+    check("sine: Pu (s)", near(sine.Pu(), 300, 0.002f), sine.Pu(), 300);
+    check("sine: Ku = 4 x 0.5 / (pi x 2)", near(sine.Ku(), 1 / PI, 0.002f), sine.Ku(), 1 / PI);
+    check("sine: done 1 + 4 cycles after the first rise (s)", sine.Done() && near(t, 1500, 0.01f), t, 1500);
+    check("done: relay held low", sine.Update(0, t) == 0, sine.Update(0, t), 0);
+
+    float kp, ki, kd, ku = sine.Ku(), pu = sine.Pu();
+    sine.Gains(AUTOTUNE_ZIEGLER_NICHOLS, kp, ki, kd);
+    check("Ziegler-Nichols kp = 0.6 Ku", near(kp, 0.6f * ku, 1e-5f), kp, 0.6f * ku);
+    check("Ziegler-Nichols ki = kp / (Pu / 2)", near(ki, kp / (0.5f * pu), 1e-5f), ki, kp / (0.5f * pu));
+    check("Ziegler-Nichols kd = kp Pu / 8", near(kd, kp * pu / 8, 1e-5f), kd, kp * pu / 8);
+    sine.Gains(AUTOTUNE_TYREUS_LUYBEN, kp, ki, kd);
+    check("Tyreus-Luyben kp = Ku / 2.2", near(kp, ku / 2.2f, 1e-5f), kp, ku / 2.2f);
+    check("Tyreus-Luyben ki = kp / (2.2 Pu)", near(ki, kp / (2.2f * pu), 1e-5f), ki, kp / (2.2f * pu));
+    check("Tyreus-Luyben kd = kp Pu / 6.3", near(kd, kp * pu / 6.3f, 1e-5f), kd, kp * pu / 6.3f);
+
+    // relay loop on K e^(-theta s) / (tau s + 1): 80 degC per unit of power,
+    // tau = 600 s, theta = 30 s. Ultimate frequency: atan(w tau) + w theta = pi
+    const float K = 80, TAU = 600, THETA = 30, DT = 0.1f;
+    float w = 0.01f;
+    for (int i = 0; i < 100; i++)
+    {
+        float g = atanf(w * TAU) + w * THETA - PI;
+        float dg = TAU / (1 + w * w * TAU * TAU) + THETA;
+        w -= g / dg;
+    }
+    float kuExact = sqrtf(1 + w * w * TAU * TAU) / K, puExact = 2 * PI / w;
+
+    relay_autotune relay(1, 0, 0.05f, 4);
+    const int DELAY = (int)(THETA / DT);
+    static float pipe[DELAY];
+    for (int i = 0; i < DELAY; i++) pipe[i] = 0;
+    float x = 62;                       // plant, degC above the 20 degC ambient is x - 20
+    relay.Start(63, 0);
+    int head = 0;
+    for (t = 0; !relay.Done() && t < 40000; t += DT)
+    {
+        float u = relay.Update(x, t);
+        float delayed = pipe[head];
+        pipe[head] = u;
+        head = (head + 1) % DELAY;
+        x += (K * delayed - (x - 20)) / TAU * DT;
+    }
+    check("dead time plant: Pu (s)", relay.Done() && near(relay.Pu(), puExact, 0.15f), relay.Pu(), puExact);
+    check("dead time plant: Ku", relay.Done() && near(relay.Ku(), kuExact, 0.25f) && relay.Ku() <= kuExact,
+          relay.Ku(), kuExact);
+
+    // best of RUNS on a slow sine, the experiment never finishes
+    double ns = 1e9;
+    for (int r = 0; r < RUNS; r++)
+    {
+        relay_autotune bench(1, 0, 0.2f, 1 << 30);
+        bench.Start(63, 0);
+        double t0 = now_ns();
+        for (int k = 0; k < UPDATES; k++)
+        {
+            sink += bench.Update(63 + ((k >> 8) & 1 ? 1.0f : -1.0f), k * 0.1f);
+        }
+        double dt = (now_ns() - t0) / UPDATES;
+        if (dt < ns) ns = dt;
+    }
+    printf("relay_autotune: %u bytes of RAM whatever the length, Update(): %.2f ns\n",
+           (unsigned)sizeof(relay_autotune), ns);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+// brew_log benchmark (./brew_sim -t brew_log): a 21 day fermentation as
+// Hub_capteurs.cpp logs it (one sample per minute: temperature, CO2,
+// humidity at TELEMETRY_SCALE) written to a FileBlockDevice image, then
+// read back with brew_log_reader. Every sample must come back unchanged.
+//
+// Two flush policies: a partial block sealed every FLUSH_JOURNAL_S as in
+// Hub_capteurs.cpp (at most an hour lost on a power cut), and blocks only
+// written when full. Reports device bytes, bytes per sample, blocks and
+// encode / decode throughput.
+//
+// Without a successful Mount() (no SD card, device smaller than a block)
+// every Append() and Flush() must fail and nothing may be written.
+
+#include "mbed.h"
+#include "brew_log.h"
+#include "FileBlockDevice.h"
+#include "telemetry.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+int brew_log_session(void);
+
+namespace {
+
+const char *IMAGE = "/tmp/brew_log_bench.img";
+const bd_size_t IMAGE_SIZE = 2048 * BREW_LOG_BLOCK_SIZE;   // the whole log area
+const uint32_t DAYS = 21;
+const uint32_t PERIOD_S = 60;           // PERIODE_JOURNAL_S
+const uint32_t FLUSH_S = 3600;          // FLUSH_JOURNAL_S
+const uint32_t SAMPLES = DAYS * 24 * 3600 / PERIOD_S;
+
+uint32_t seed = 7;
+
+// uniform noise in [-a, a]
+float noise(float a)
+{
+    seed = seed * 1664525 + 1013904223;
+    return a * ((seed >> 8) / 8388608.0f - 1);
+}
+
+// fermentation: 20 degC held by the PID, CO2 rising then falling over the
+// first week, humidity of the headspace; SCD30 and PT100 noise on each sample
+brew_sample sample_at(uint32_t i)
+{
+    brew_sample s;
+    float days = i * PERIOD_S / 86400.0f;
+    float activity = days / 2 * expf(1 - days / 2);
+    s.time = i * PERIOD_S;
+    s.value[0] = (int32_t)lroundf((20 + 0.05f * sinf(i * 0.02f) + noise(0.02f)) * TELEMETRY_SCALE);
+    s.value[1] = (int32_t)lroundf((600 + 4000 * activity + noise(15)) * TELEMETRY_SCALE);
+    s.value[2] = (int32_t)lroundf((70 + 10 * activity + noise(0.3f)) * TELEMETRY_SCALE);
+    s.value[3] = 0;
+    return s;
+}
+
+struct result {
+    uint32_t blocks;
+    double writeNs, readNs;
+    long wrong;
+};
+
+double now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+result run(bool hourlyFlush)
+{
+    result r = { 0, 0, 0, 0 };
+    remove(IMAGE);
+    FileBlockDevice bd(IMAGE, IMAGE_SIZE);
+    bd.init();
+
+    brew_log log(bd, 3);
+    log.Mount();
+    double t0 = now_ns();
+    seed = 7;
+    for (uint32_t i = 0; i < SAMPLES; i++)
+    {
+        log.Append(sample_at(i));
+        if (hourlyFlush && (i + 1) * PERIOD_S % FLUSH_S == 0) log.Flush();
+    }
+    log.Flush();
+    r.writeNs = (now_ns() - t0) / SAMPLES;
+    r.blocks = log.BlocksWritten();
+
+    brew_log_reader reader(bd);
+    reader.Open();
+    brew_sample s;
+    uint32_t n = 0;
+    seed = 7;
+    t0 = now_ns();
+    while (reader.Next(s))
+    {
+        brew_sample e = sample_at(n++);
+        if (s.time != e.time || s.value[0] != e.value[0] || s.value[1] != e.value[1] || s.value[2] != e.value[2]) r.wrong++;
+    }
+    r.readNs = (now_ns() - t0) / SAMPLES;
+    if (n != SAMPLES) r.wrong += n > SAMPLES ? n - SAMPLES : SAMPLES - n;
+
+    bd.deinit();
+    remove(IMAGE);
+    return r;
+}
+
+}
+
+int brew_log_session(void)
+{
+    int failures = 0;
+    printf("%u days, %u samples of 3 channels (%u raw bytes)\n", DAYS, SAMPLES, SAMPLES * 16);
+    printf("flush            blocks  device(KB)  bytes/sample  write(ns/sample)  read(ns/sample)  wrong\n");
+    for (int hourly = 1; hourly >= 0; hourly--)
+    {
+        result r = run(hourly);
+        double kb = r.blocks * BREW_LOG_BLOCK_SIZE / 1024.0;
+        printf("%-15s  %6u  %10.1f  %12.2f  %16.0f  %15.0f  %5ld  %s\n", hourly ? "every hour" : "full blocks",
+               r.blocks, kb, (double)r.blocks * BREW_LOG_BLOCK_SIZE / SAMPLES, r.writeNs, r.readNs, r.wrong,
+               r.wrong ? "FAIL" : "ok");
+        if (r.wrong) failures++;
+    }
+
+    // unmounted log: a day of samples, each one refused
+    FileBlockDevice tiny(IMAGE, BREW_LOG_BLOCK_SIZE / 2);
+    tiny.init();
+    brew_log unmounted(tiny, 3);
+    long accepted = 0;
+    for (uint32_t i = 0; i < 24 * 3600 / PERIOD_S; i++)
+    {
+        if (unmounted.Append(sample_at(i)) == 0) accepted++;
+    }
+    int mount = unmounted.Mount();
+    for (uint32_t i = 0; i < 24 * 3600 / PERIOD_S; i++)
+    {
+        if (unmounted.Append(sample_at(i)) == 0) accepted++;
+    }
+    if (unmounted.Flush() == 0) accepted++;
+    bool ok = mount != 0 && accepted == 0 && unmounted.Samples() == 0 && unmounted.BlocksWritten() == 0;
+    printf("not mounted, then device under one block: %ld samples accepted  %s\n", accepted, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+    tiny.deinit();
+    remove(IMAGE);
+    return failures ? 1 : 0;
+}
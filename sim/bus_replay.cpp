@@ -0,0 +1,394 @@
+#include "bus_replay.h"
+#include "max31865.h"
+#include "scd30.h"
+#include "rtd_table.h"
+#include "filters.h"
+#include "pid.h"
+#include "crc8.h"
+#include <chrono>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Recording
+
+bool bus_player::Load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t chunk[4096];
+    size_t n;
+    data.clear();
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) data.insert(data.end(), chunk, chunk + n);
+    fclose(f);
+
+    if (data.size() < 5 || memcmp(data.data(), BUS_RECORD_MAGIC, 4) != 0 || data[4] != BUS_RECORD_VERSION) return false;
+    for (int i = 0; i < BUS_REPLAY_MAX_BUSES; i++) cursor[i] = { 5, 0 };
+
+    // count the records once, also checks the file is not truncated in the middle
+    position p = { 5, 0 };
+    uint8_t tag, address;
+    int result;
+    size_t tx, rx;
+    uint32_t txLen, rxLen;
+    records = served = mismatches = 0;
+    while (Parse(p, tag, address, result, tx, txLen, rx, rxLen)) records++;
+    return true;
+}
+
+bool bus_player::Varint(size_t &offset, uint32_t &v)
+{
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (offset >= data.size()) return false;
+        uint8_t c = data[offset++];
+        v |= (uint32_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+bool bus_player::Parse(position &p, uint8_t &tag, uint8_t &address, int &result,
+                       size_t &tx, uint32_t &txLen, size_t &rx, uint32_t &rxLen)
+{
+    size_t o = p.offset;
+    uint32_t dt;
+    if (o >= data.size()) return false;
+    tag = data[o++];
+    if (!Varint(o, dt)) return false;
+    if (o + 2 > data.size()) return false;
+    address = data[o++];
+    result = (int8_t)data[o++];
+    if (!Varint(o, txLen) || o + txLen > data.size()) return false;
+    tx = o;
+    o += txLen;
+    if (!Varint(o, rxLen) || o + rxLen > data.size()) return false;
+    rx = o;
+    o += rxLen;
+    p.offset = o;
+    p.time += dt;
+    return true;
+}
+
+bool bus_player::HasMore(uint8_t bus)
+{
+    position p = cursor[bus];
+    uint8_t tag, address;
+    int result;
+    size_t tx, rx;
+    uint32_t txLen, rxLen;
+    while (Parse(p, tag, address, result, tx, txLen, rx, rxLen))
+    {
+        if ((tag >> 4) == bus) return true;
+    }
+    return false;
+}
+
+bool bus_player::Next(uint8_t bus, uint8_t kind, int address, const char *txReq, int txReqLen,
+                      char *rxReq, int rxReqLen, int &result)
+{
+    position &p = cursor[bus];
+    uint8_t tag, addr;
+    size_t tx, rx;
+    uint32_t txLen, rxLen;
+    while (Parse(p, tag, addr, result, tx, txLen, rx, rxLen))
+    {
+        if ((tag >> 4) != bus) continue;
+
+        bool same = (tag & 15) == kind && addr == (uint8_t)address && (int)txLen == txReqLen;
+        if (same && txReqLen) same = memcmp(&data[tx], txReq, txLen) == 0;
+        if (same && rxReq) same = (int)rxLen == rxReqLen;
+        if (!same) mismatches++;
+
+        if (rxReq)
+        {
+            for (int i = 0; i < rxReqLen; i++) rxReq[i] = i < (int)rxLen ? data[rx + i] : 0xFF;
+        }
+        served++;
+        return true;
+    }
+
+    // end of the recording for this bus: idle bus
+    if (rxReq) memset(rxReq, 0xFF, rxReqLen);
+    result = -1;
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Transports
+
+int spi_replayer::transfer(const char *tx, int txLen, char *rx, int rxLen)
+{
+    int result;
+    player.Next(id, BUSspi, 0, tx, txLen, rx, rx ? rxLen : 0, result);
+    return txLen > rxLen ? txLen : rxLen;
+}
+
+int i2c_replayer::write(int address, const char *data, int length, bool repeated)
+{
+    int result;
+    player.Next(id, BUSi2cWrite, address, data, length, NULL, 0, result);
+    return result;
+}
+
+int i2c_replayer::read(int address, char *data, int length, bool repeated)
+{
+    int result;
+    player.Next(id, BUSi2cRead, address, NULL, 0, data, length, result);
+    return result;
+}
+
+int i2c_replayer::transfer(int address, const char *tx, int txLen, char *rx, int rxLen,
+                           const event_callback_t &cb, int event, bool repeated)
+{
+    // i2c_recorder stores an async transfer as a write and / or a read record
+    int result = 0, r;
+    if (!queue) return -1;
+    if (txLen)
+    {
+        if (!player.Next(id, BUSi2cWrite, address, tx, txLen, NULL, 0, r)) return -1;
+        result |= r;
+    }
+    if (rxLen)
+    {
+        if (!player.Next(id, BUSi2cRead, address, NULL, 0, rx, rxLen, r)) return -1;
+        result |= r;
+    }
+    event_callback_t done = cb;
+    int ev = result ? I2C_EVENT_ERROR_NO_SLAVE : I2C_EVENT_TRANSFER_COMPLETE;
+    queue->call([done, ev]() { done(ev); });
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Hub_capteurs.cpp driver calls on the sim EventQueue, shared by the
+// recording and the replay so both sides issue the same transactions:
+// probe read every second (median, table, PID), scd30 restarted with a
+// soft reset and read by startSampling(), restarted again on an off-scale CO2
+
+namespace {
+
+const int HUB_PERIOD_MS = 1000;         // PERIODE_REGULATION_MS
+const int HUB_SCD30_INTERVAL_S = 5;     // INTERVALLE_SCD30_S
+const int HUB_SCD30_START_MS = 2000;    // DEMARRAGE_SCD30_MS
+const float T_MIN = 0, T_MAX = 105;     // plausible water temperatures (degC)
+
+struct hub_session {
+    EventQueue queue;
+    max31865 *probe = NULL;
+    scd30 *scd = NULL;
+    bus_player *player = NULL;          // replay: stop reading the probe at the end of its records
+    bool heat = false;                        // recording: the PID output drives the simulated plate
+    median_filter<int, 3> filter;
+    pid<float> regulator{ 0.5f, 0.002f, 0, HUB_PERIOD_MS / 1000.0f };
+    long samples = 0, outOfRange = 0, measures = 0, errors = 0;
+    float tMin = 1e9f, tMax = -1e9f, duty = 0;
+    double co2Sum = 0;
+};
+
+constexpr rtd_table<> Hub_table(430.0, 100.0);
+hub_session *hub;
+
+void hub_regulation()
+{
+    if (hub->player && !hub->player->HasMore(0)) return;
+    float t = Hub_table.CentiDegrees(hub->filter.Update(hub->probe->ReadRTD())) * 0.01f;
+    float u = hub->regulator.Update(t);
+    if (hub->heat) sim::set_heater(u);
+    hub->duty += u;
+    if (t < hub->tMin) hub->tMin = t;
+    if (t > hub->tMax) hub->tMax = t;
+    if (t < T_MIN || t > T_MAX) hub->outOfRange++;
+    hub->samples++;
+}
+
+void hub_scd30_start();
+
+void hub_scd30_measure(scd30::Measurement m)
+{
+    if (m.status != scd30::SCDnoERROR)
+    {
+        hub->errors++;
+        return;
+    }
+    hub->measures++;
+    hub->co2Sum += m.co2;
+    if ((int)m.co2 > 10000)
+    {
+        hub->scd->stopSampling();
+        hub->scd->softReset();
+        hub->queue.call_in(HUB_SCD30_START_MS, hub_scd30_start);
+    }
+}
+
+void hub_scd30_start()
+{
+    hub->scd->setMeasInterval(HUB_SCD30_INTERVAL_S);
+    hub->scd->startMeasurement(0);
+    hub->scd->startSampling(HUB_SCD30_INTERVAL_S, hub_scd30_measure, NC);
+}
+
+// Begin() starts the first conversion, the first read waits for it as in Regulation_temperature.cpp
+void hub_start(hub_session &h, max31865 &probe, scd30 &scd)
+{
+    hub = &h;
+    h.probe = &probe;
+    h.scd = &scd;
+    h.regulator.SetSetpoint(40);
+    probe.Begin(MAX31865_3WIRE);
+    wait_us(MAX31865_CONVERSION_US);
+    scd.attachQueue(&h.queue);
+    scd.softReset();
+    h.queue.call_in(HUB_SCD30_START_MS, hub_scd30_start);
+    h.queue.call_every(HUB_PERIOD_MS, hub_regulation);
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Session: same driver calls as Hub_capteurs.cpp
+
+int replay_session(const char *path)
+{
+    bus_player player;
+    if (!player.Load(path))
+    {
+        printf("%s: not a bus recording\n", path);
+        return 2;
+    }
+
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+
+    hub_session h;
+    h.player = &player;
+    h.heat = false;
+    spi_replayer probeBus(player, 0);
+    max31865 probe(probeBus);
+    i2c_replayer scdBus(player, 1, &h.queue);
+    scd30 scd(scdBus);
+    hub_start(h, probe, scd);
+    while (player.HasMore(0) || player.HasMore(1)) h.queue.dispatch(HUB_PERIOD_MS);
+    scd.stopSampling();
+
+    std::chrono::steady_clock::time_point wallEnd = std::chrono::steady_clock::now();
+    double wall = std::chrono::duration_cast<std::chrono::microseconds>(wallEnd - wallStart).count() / 1e6;
+    double span = (player.Time(0) > player.Time(1) ? player.Time(0) : player.Time(1)) / 1e6;
+
+    printf("recording: %u records over %.1f h\n", player.Records(), span / 3600);
+    printf("max31865: %ld samples, %.2f .. %.2f C, %ld outside %.0f .. %.0f C, mean duty %.3f\n", h.samples, h.tMin,
+           h.tMax, h.outOfRange, T_MIN, T_MAX, h.samples ? h.duty / h.samples : 0);
+    printf("scd30: %ld measures, %ld errors, mean CO2 %.1f ppm\n", h.measures, h.errors,
+           h.measures ? h.co2Sum / h.measures : 0);
+    printf("served %u, mismatches %u, wall %.3f s (%.0fx real time)\n", player.Served(), player.Mismatches(),
+           wall, wall > 0 ? span / wall : 0);
+    char line[BUS_STATS_LINE_SIZE];
+    probe.ReadStats().Print(line, sizeof(line), "spi read");
+    printf("%s\n", line);
+    probe.WriteStats().Print(line, sizeof(line), "spi write");
+    printf("%s\n", line);
+    scd.stats().Print(line, sizeof(line), "i2c scd30");
+    printf("%s\n", line);
+    return player.Mismatches() || h.outOfRange || !h.samples ? 1 : 0;
+}
+
+//-----------------------------------------------------------------------------
+// Session recorded on the simulated tank
+
+namespace {
+
+const uint32_t RECORD_S = 24 * 3600;
+const uint64_t SCD30_PERIOD_US = 5002000;  // 5 s interval, the sensor clock runs a little slow
+const int I2C_TRANSFER_MS = 1;
+
+// SCD30 answering the commands of scd30.cpp: ready once per period, CO2
+// of a fermentation start, temperature of the tank, CRC on every word.
+// Async transfers complete I2C_TRANSFER_MS later through the queue
+class scd30_model : public i2c_transport {
+    public:
+    scd30_model(EventQueue &queue) : queue(queue) {}
+
+    virtual int write(int address, const char *data, int length, bool repeated = false)
+    {
+        if (length >= 2) command = ((uint8_t)data[0] << 8) | (uint8_t)data[1];
+        return 0;
+    }
+
+    virtual int read(int address, char *data, int length, bool repeated = false)
+    {
+        uint64_t now = sim::now_us();
+        if (command == SCD30_CMMD_GET_READY_STAT && length >= 3)
+        {
+            Word(data, now >= next);
+        }
+        else if (command == SCD30_CMMD_READ_MEAS && length >= 18)
+        {
+            float hours = now / 3.6e9f;
+            float value[3] = { 450 + 1200 * hours / 24, sim::probe_temperature(NC), 55 + 5 * sinf(hours) };
+            for (int i = 0; i < 3; i++)
+            {
+                uint32_t u;
+                memcpy(&u, &value[i], sizeof(u));
+                Word(data + 6 * i, u >> 16);
+                Word(data + 6 * i + 3, u);
+            }
+            while (next <= now) next += SCD30_PERIOD_US;
+        }
+        return 0;
+    }
+
+    virtual int transfer(int address, const char *tx, int txLen, char *rx, int rxLen,
+                         const event_callback_t &cb, int event, bool repeated)
+    {
+        if (txLen) write(address, tx, txLen);
+        if (rxLen) read(address, rx, rxLen);
+        event_callback_t done = cb;
+        queue.call_in(I2C_TRANSFER_MS, [done]() { done(I2C_EVENT_TRANSFER_COMPLETE); });
+        return 0;
+    }
+
+    private:
+    EventQueue &queue;
+    uint16_t command = 0;
+    uint64_t next = SCD30_PERIOD_US;
+
+    void Word(char *p, uint16_t w)
+    {
+        p[0] = w >> 8;
+        p[1] = w;
+        p[2] = crc8_31.compute(0xFF, (const uint8_t *)p, 2);
+    }
+};
+
+}
+
+int record_session(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+    {
+        printf("%s: cannot write\n", path);
+        return 2;
+    }
+    bus_recorder rec(f);
+
+    // the PID of the session heats the simulated tank, the scd30 is read by startSampling()
+    hub_session h;
+    h.heat = true;
+    mbed_spi_transport spi(PB_5, PB_4, PB_3, PA_11, 1, 500000);
+    spi_recorder probeBus(spi, rec, 0);
+    max31865 probe(probeBus);
+    scd30_model sensor(h.queue);
+    i2c_recorder scdBus(sensor, rec, 1);
+    scd30 scd(scdBus);
+    hub_start(h, probe, scd);
+    h.queue.dispatch(RECORD_S * 1000);
+
+    // let the last command finish, its records are still in the i2c recorder
+    scd.stopSampling();
+    h.queue.dispatch(HUB_PERIOD_MS);
+    rec.flush();
+    fclose(f);
+    printf("%s: %u records, %u bytes over %.1f h, %ld probe samples, %ld CO2 measures\n", path, rec.records(),
+           rec.bytes(), RECORD_S / 3600.0, h.samples, h.measures);
+    return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef BUS_REPLAY_H
+#define BUS_REPLAY_H
+
+// Replay of a bus recording (bus_record.h) on Linux.
+//
+// The whole file is loaded in memory. Each bus has its own cursor, so a
+// driver on bus 0 and another on bus 1 can be replayed one after the other
+// or interleaved. Every request is checked against the recorded one (kind,
+// address, sent bytes); a mismatch means the driver no longer talks to the
+// chip the way it did when the session was captured.
+
+#include "bus_record.h"
+#include <vector>
+
+#define BUS_REPLAY_MAX_BUSES            16
+
+class bus_player {
+    public:
+
+    // false if the file is missing or not a recording
+    bool Load(const char *path);
+
+    // serve the next record of a bus, false when the bus has no more records
+    bool Next(uint8_t bus, uint8_t kind, int address, const char *tx, int txLen, char *rx, int rxLen, int &result);
+
+    bool HasMore(uint8_t bus);
+
+    uint64_t Time(uint8_t bus) const { return cursor[bus].time; }   // us, last served record
+    uint32_t Served() const { return served; }
+    uint32_t Mismatches() const { return mismatches; }
+    uint32_t Records() const { return records; }
+
+    private:
+    struct position {
+        size_t offset;
+        uint64_t time;
+    };
+
+    std::vector<uint8_t> data;
+    position cursor[BUS_REPLAY_MAX_BUSES];
+    uint32_t records = 0, served = 0, mismatches = 0;
+
+    // decode the record at p.offset (time updated), false at the end or on a truncated record
+    bool Parse(position &p, uint8_t &tag, uint8_t &address, int &result,
+               size_t &tx, uint32_t &txLen, size_t &rx, uint32_t &rxLen);
+    bool Varint(size_t &offset, uint32_t &v);
+};
+
+class spi_replayer : public spi_transport {
+    public:
+    spi_replayer(bus_player &player, uint8_t id) : player(player), id(id) {}
+    virtual int transfer(const char *tx, int txLen, char *rx, int rxLen);
+    private:
+    bus_player &player;
+    uint8_t id;
+};
+
+// async transfers (scd30 startSampling) are served from the same write and
+// read records as the blocking calls, completion is posted to the queue as
+// the I2C interrupt would; without a queue they are refused
+class i2c_replayer : public i2c_transport {
+    public:
+    i2c_replayer(bus_player &player, uint8_t id, EventQueue *queue = NULL) : player(player), id(id), queue(queue) {}
+    virtual int write(int address, const char *data, int length, bool repeated = false);
+    virtual int read(int address, char *data, int length, bool repeated = false);
+    virtual int transfer(int address, const char *tx, int txLen, char *rx, int rxLen,
+                         const event_callback_t &cb, int event, bool repeated);
+    private:
+    bus_player &player;
+    uint8_t id;
+    EventQueue *queue;
+};
+
+// replay a Hub_capteurs.cpp recording (max31865 on bus 0, scd30 on bus 1)
+// through the drivers and the control code on the sim EventQueue, the scd30
+// read by startSampling() as in Hub_capteurs.cpp. Exit code 1 if the drivers
+// diverge from the recording or a temperature is out of range
+int replay_session(const char *path);
+
+// record 24 h of the same driver calls on the simulated tank (max31865
+// model of the stand-ins, an SCD30 model answering on I2C), the input of
+// replay_session() when no recording from the brewery is at hand
+int record_session(const char *path);
+
+#endif
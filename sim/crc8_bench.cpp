@@ -0,0 +1,123 @@
+// CRC-8 check and benchmark (./brew_sim -t crc8): the table driven crc8
+// against the bitwise loop scd30::calcCrc2b used before, on every 16 bit
+// word, then the cpu time of checking one 18 byte READ_MEAS frame word by
+// word with the old loop and in one pass with scd30::verifyFrame().
+
+#include "mbed.h"
+#include "crc8.h"
+#include "scd30.h"
+#include <chrono>
+#include <stdio.h>
+
+int crc8_session(void);
+
+namespace {
+
+const int FRAMES = 200000;
+const int RUNS = 5;
+
+unsigned sink;
+
+// the bitwise CRC of the original driver, as reference
+uint8_t bitwise_crc2b(uint16_t seed)
+{
+    uint8_t crc = SCD30_CRC_INIT;
+    crc ^= (seed >> 8) & 255;
+    for (uint8_t bit = 8; bit > 0; --bit)
+    {
+        if (crc & 0x80) crc = (crc << 1) ^ SCD30_POLYNOMIAL;
+        else            crc = (crc << 1);
+    }
+    crc ^= seed & 255;
+    for (uint8_t bit = 8; bit > 0; --bit)
+    {
+        if (crc & 0x80) crc = (crc << 1) ^ SCD30_POLYNOMIAL;
+        else            crc = (crc << 1);
+    }
+    return crc;
+}
+
+// readMeasurement before the table: six words, six calcCrc2b
+uint8_t bitwise_frame(const uint8_t *buff, int words)
+{
+    for (int i = 0; i < words; i++)
+    {
+        if (bitwise_crc2b((buff[0] << 8) | buff[1]) != buff[2]) return i + 1;
+        buff += 3;
+    }
+    return 0;
+}
+
+double now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+int crc8_session(void)
+{
+    int failures = 0;
+
+    // same CRC on every word, the datasheet example is 0xBEEF -> 0x92
+    long mismatches = 0;
+    for (long w = 0; w < 65536; w++)
+    {
+        uint8_t msb = w >> 8, lsb = w & 255;
+        uint8_t crc = crc8_31.update(crc8_31.update(SCD30_CRC_INIT, msb), lsb);
+        if (crc != bitwise_crc2b(w)) mismatches++;
+    }
+    bool example = bitwise_crc2b(0xBEEF) == 0x92 && crc8_31.update(crc8_31.update(0xFF, 0xBE), 0xEF) == 0x92;
+    printf("crc of 65536 words: %ld mismatches, 0xBEEF -> 0x92: %s\n", mismatches, example ? "ok" : "FAIL");
+    if (mismatches || !example) failures++;
+
+    // frames with slowly changing values, one corrupted word every 7 frames
+    static uint8_t frames[64][SCD30_MEAS_FRAME_SIZE];
+    for (int f = 0; f < 64; f++)
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            uint16_t v = 0x43c8 + f * 13 + i * 997;
+            frames[f][3 * i] = v >> 8;
+            frames[f][3 * i + 1] = v & 255;
+            frames[f][3 * i + 2] = bitwise_crc2b(v);
+        }
+        if (f % 7 == 3) frames[f][3 * (f % 6) + 1] ^= 0x10;
+    }
+
+    // both report the same first bad word
+    int wrongWord = 0;
+    for (int f = 0; f < 64; f++)
+    {
+        uint8_t expected = f % 7 == 3 ? f % 6 + 1 : 0;
+        if (scd30::verifyFrame(frames[f], 6) != expected || bitwise_frame(frames[f], 6) != expected) wrongWord++;
+    }
+    printf("bad word located in %d / 64 frames: %s\n", 64 - wrongWord, wrongWord ? "FAIL" : "ok");
+    if (wrongWord) failures++;
+
+    // best of RUNS, the host scheduler adds noise
+    double bitwiseNs = 1e9, tableNs = 1e9;
+    for (int r = 0; r < RUNS; r++)
+    {
+        double t0 = now_ns();
+        for (int k = 0; k < FRAMES; k++)
+        {
+            sink += bitwise_frame(frames[k & 63], 6);
+        }
+        double t = (now_ns() - t0) / FRAMES;
+        if (t < bitwiseNs) bitwiseNs = t;
+
+        t0 = now_ns();
+        for (int k = 0; k < FRAMES; k++)
+        {
+            sink += scd30::verifyFrame(frames[k & 63], 6);
+        }
+        t = (now_ns() - t0) / FRAMES;
+        if (t < tableNs) tableNs = t;
+    }
+
+    printf("18 byte frame check  bitwise: %.1f ns  table (%d entries): %.1f ns  %.2fx\n", bitwiseNs,
+           CRC8_TABLE_SIZE, tableNs, bitwiseNs / tableNs);
+    return failures ? 1 : 0;
+}
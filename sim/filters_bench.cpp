@@ -0,0 +1,160 @@
+// Filter stage check and benchmark (./brew_sim -t filters): each stage of
+// filters.h against a plain recomputation over its window on a noisy RTD
+// code stream with relay spikes, then the cpu time per sample of every
+// stage and of the median + average pipeline used before the PID.
+
+#include "mbed.h"
+#include "filters.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+
+int filters_session(void);
+
+namespace {
+
+const int SAMPLES = 100000;
+const int RUNS = 5;
+
+int stream[SAMPLES];
+int failures = 0;
+long sink;
+
+// RTD code around 63 degC, +-2 codes of noise, an isolated spike every 97 samples
+void make_stream()
+{
+    uint32_t seed = 1;
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        stream[i] = 9400 + i / 1000 + (int)((seed >> 24) % 5) - 2;
+        if (i % 97 == 50) stream[i] += (seed >> 20) & 1 ? 3000 : -3000;
+    }
+}
+
+void check(const char *name, long wrong)
+{
+    printf("%-36s %6ld wrong  %s\n", name, wrong, wrong ? "FAIL" : "ok");
+    if (wrong) failures++;
+}
+
+// window of the last n samples ending at i, primed with stream[0] as median_filter does
+int window_at(int i, int k, int n)
+{
+    int j = i - n + 1 + k;
+    return stream[j < 0 ? 0 : j];
+}
+
+template <int N>
+long median_wrong()
+{
+    median_filter<int, N> f;
+    long wrong = 0;
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        int v[N];
+        for (int k = 0; k < N; k++) v[k] = window_at(i, k, N);
+        std::sort(v, v + N);
+        if (f.Update(stream[i]) != v[N / 2]) wrong++;
+    }
+    return wrong;
+}
+
+template <typename F>
+double time_stage(F update)
+{
+    double best = 1e9;
+    for (int r = 0; r < RUNS; r++)
+    {
+        double t0 = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        for (int i = 0; i < SAMPLES; i++) sink += update(stream[i]);
+        double t = (std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count() - t0) / SAMPLES;
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+}
+
+int filters_session(void)
+{
+    failures = 0;
+    make_stream();
+
+    // ring buffer: [0] oldest, overwritten when full
+    ring_buffer<int, 8> ring;
+    long wrong = 0;
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        ring.Push(stream[i]);
+        int n = ring.Count();
+        for (int k = 0; k < n; k++) if (ring[k] != stream[i - n + 1 + k]) wrong++;
+    }
+    check("ring_buffer<int, 8> order", wrong);
+
+    // moving average: running sum against the window sum
+    moving_average<int, 16, int32_t> average;
+    wrong = 0;
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        int n = i + 1 < 16 ? i + 1 : 16;
+        long sum = 0;
+        for (int k = 0; k < n; k++) sum += stream[i - k];
+        if (average.Update(stream[i]) != sum / n) wrong++;
+    }
+    check("moving_average<int, 16, int32_t>", wrong);
+
+    check("median_filter<int, 3> (network)", median_wrong<3>());
+    check("median_filter<int, 5> (network)", median_wrong<5>());
+    check("median_filter<int, 7> (insertion)", median_wrong<7>());
+
+    // isolated spikes never reach the output of a 3 sample median
+    median_filter<int, 3> median;
+    long spikes = 0;
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        int m = median.Update(stream[i]);
+        if (m > 9400 + i / 1000 + 100 || m < 9400 + i / 1000 - 100) spikes++;
+    }
+    check("spikes through median_filter<int, 3>", spikes);
+
+    // boxcar: one output every N inputs, mean of those N
+    boxcar_decimator<int, 8, int32_t> boxcar;
+    wrong = 0;
+    long outputs = 0;
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        int out;
+        bool ready = boxcar.Update(stream[i], out);
+        if (ready != (i % 8 == 7)) wrong++;
+        if (!ready) continue;
+        outputs++;
+        long sum = 0;
+        for (int k = 0; k < 8; k++) sum += stream[i - k];
+        if (out != sum / 8) wrong++;
+    }
+    check("boxcar_decimator<int, 8, int32_t>", wrong + (outputs != SAMPLES / 8));
+
+    // cpu time per input sample
+    ring_buffer<int, 16> r16;
+    moving_average<int, 16, int32_t> ma16;
+    moving_average<float, 16> maf;
+    median_filter<int, 3> m3;
+    median_filter<int, 5> m5;
+    median_filter<int, 7> m7;
+    boxcar_decimator<int, 8, int32_t> box;
+    median_filter<int, 3> pm;
+    moving_average<int, 4, int32_t> pa;
+    printf("stage                                ns/sample\n");
+    printf("ring_buffer<int, 16>::Push           %9.2f\n", time_stage([&](int x) { return r16.Push(x); }));
+    printf("moving_average<int, 16, int32_t>     %9.2f\n", time_stage([&](int x) { return ma16.Update(x); }));
+    printf("moving_average<float, 16>            %9.2f\n", time_stage([&](int x) { return (int)maf.Update(x); }));
+    printf("median_filter<int, 3>                %9.2f\n", time_stage([&](int x) { return m3.Update(x); }));
+    printf("median_filter<int, 5>                %9.2f\n", time_stage([&](int x) { return m5.Update(x); }));
+    printf("median_filter<int, 7>                %9.2f\n", time_stage([&](int x) { return m7.Update(x); }));
+    printf("boxcar_decimator<int, 8, int32_t>    %9.2f\n", time_stage([&](int x) { int o = 0; box.Update(x, o); return o; }));
+    printf("median 3 + average 4 pipeline        %9.2f\n", time_stage([&](int x) { return pa.Update(pm.Update(x)); }));
+    return failures ? 1 : 0;
+}
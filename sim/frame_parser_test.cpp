@@ -0,0 +1,184 @@
+// frame_parser fuzz test and benchmark (./brew_sim -t frame_parser):
+//
+//  - clean stream: every frame decoded with its type and value
+//  - 200 x 2000 frames with 3 % of the bytes dropped: every frame that
+//    arrived whole is decoded, nothing else is, and in order
+//  - random bytes drawn from the frame alphabet (start, end, types, digits,
+//    a few others): frames decoded == 6 byte windows that form a valid frame
+//  - throughput in MB/s on a stream with 10 % noise bytes injected
+
+#include "mbed.h"
+#include "frame_parser.h"
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+int frame_parser_session(void);
+
+namespace {
+
+const int ROUNDS = 200;
+const int FRAMES = 2000;
+const int FRAME_SIZE = 6;
+const int RANDOM_BYTES = 4 << 20;
+const int RUNS = 5;
+const uint8_t TYPES[] = { TELEMETRY_TEMPERATURE, TELEMETRY_HUMIDITE, TELEMETRY_PH, TELEMETRY_CO2,
+                          TELEMETRY_VISCOSITE };
+
+struct sent {
+    uint8_t type;
+    int value;
+};
+
+uint32_t seed = 2024;
+int failures = 0;
+
+uint32_t next_random()
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+// frames as the callback sees them
+std::vector<sent> received;
+
+void on_frame(uint8_t type, int value)
+{
+    received.push_back({ type, value });
+}
+
+sent random_frame()
+{
+    sent f = { TYPES[next_random() % 5], (int)(next_random() % 1000) };
+    return f;
+}
+
+// as Envoie_Donners: start, type, tens, units, tenths, end
+void put_frame(uint8_t *p, const sent &f)
+{
+    p[0] = TELEMETRY_START;
+    p[1] = f.type;
+    p[2] = '0' + f.value / 100;
+    p[3] = '0' + f.value / 10 % 10;
+    p[4] = '0' + f.value % 10;
+    p[5] = TELEMETRY_END;
+}
+
+void check(const char *name, long value, long expected)
+{
+    printf("%-52s %9ld  expected %9ld  %s\n", name, value, expected, value == expected ? "ok" : "FAIL");
+    if (value != expected) failures++;
+}
+
+double now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+int frame_parser_session(void)
+{
+    failures = 0;
+    frame_parser parser(on_frame);
+    uint8_t frame[FRAME_SIZE];
+
+    // clean stream
+    received.clear();
+    long wrong = 0;
+    std::vector<sent> clean;
+    for (int i = 0; i < FRAMES; i++)
+    {
+        clean.push_back(random_frame());
+        put_frame(frame, clean.back());
+        parser.feed(frame, FRAME_SIZE);
+    }
+    for (size_t i = 0; i < received.size() && i < clean.size(); i++)
+    {
+        if (received[i].type != clean[i].type || received[i].value != clean[i].value) wrong++;
+    }
+    check("clean stream: frames decoded", (long)received.size(), FRAMES);
+    check("clean stream: wrong type or value", wrong, 0);
+    check("clean stream: errors + skipped bytes", parser.errors() + parser.skipped(), 0);
+
+    // dropped bytes: whole frames come through, partial ones never do
+    long lost = 0, extra = 0;
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        std::vector<sent> whole;
+        received.clear();
+        parser.reset();
+        for (int i = 0; i < FRAMES; i++)
+        {
+            sent f = random_frame();
+            put_frame(frame, f);
+            int kept = 0;
+            for (int k = 0; k < FRAME_SIZE; k++)
+            {
+                if (next_random() % 100 < 3) continue;
+                parser.feed(frame[k]);
+                kept++;
+            }
+            if (kept == FRAME_SIZE) whole.push_back(f);
+        }
+        size_t j = 0;
+        for (size_t i = 0; i < received.size(); i++)
+        {
+            while (j < whole.size() && (whole[j].type != received[i].type || whole[j].value != received[i].value))
+            {
+                j++;
+                lost++;
+            }
+            if (j == whole.size()) extra++;
+            else j++;
+        }
+        lost += whole.size() - j;
+    }
+    check("3 % drops: whole frames not decoded", lost, 0);
+    check("3 % drops: frames decoded that were not sent whole", extra, 0);
+
+    // random bytes of the frame alphabet
+    static uint8_t noise[RANDOM_BYTES];
+    const uint8_t ALPHABET[] = { TELEMETRY_START, TELEMETRY_END, TELEMETRY_TEMPERATURE, TELEMETRY_HUMIDITE,
+                                 TELEMETRY_PH, TELEMETRY_CO2, TELEMETRY_VISCOSITE, 'A', 0x00, 0xFF };
+    for (int i = 0; i < RANDOM_BYTES; i++)
+    {
+        uint32_t x = next_random();
+        noise[i] = x % 2 ? '0' + x / 2 % 10 : ALPHABET[x / 2 % sizeof(ALPHABET)];
+    }
+    long windows = 0;
+    for (int i = 0; i + FRAME_SIZE <= RANDOM_BYTES; i++)
+    {
+        const uint8_t *p = noise + i;
+        if (p[0] == TELEMETRY_START && frame_parser::validType(p[1]) && p[2] >= '0' && p[2] <= '9'
+            && p[3] >= '0' && p[3] <= '9' && p[4] >= '0' && p[4] <= '9' && p[5] == TELEMETRY_END) windows++;
+    }
+    parser.reset();
+    check("4 MB of frame alphabet: frames == valid windows", parser.feed(noise, RANDOM_BYTES), windows);
+
+    // throughput, 1 noise byte in 10
+    std::vector<uint8_t> stream;
+    for (int i = 0; i < 100000; i++)
+    {
+        put_frame(frame, random_frame());
+        for (int k = 0; k < FRAME_SIZE; k++)
+        {
+            if (next_random() % 10 == 0) stream.push_back((uint8_t)next_random());
+            stream.push_back(frame[k]);
+        }
+    }
+    frame_parser counter((frame_parser::frameCallback()));
+    double best = 1e9;
+    long frames = 0;
+    for (int r = 0; r < RUNS; r++)
+    {
+        double t0 = now_ns();
+        frames = counter.feed(stream.data(), stream.size());
+        double t = now_ns() - t0;
+        if (t < best) best = t;
+    }
+    printf("%u bytes with 10 %% noise, %ld frames: %.1f MB/s, %.2f ns/byte\n", (unsigned)stream.size(), frames,
+           stream.size() / best * 1000, best / stream.size());
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+// max31865 SPI cost check (./brew_sim -t max31865): chip select cycles per
+// temperature sample, counted by the driver bus statistics on the simulated
+// chip. With the shadow config register a healthy sample is one config write
+// and one RTD read; the driver before it read back the config register for
+// the fault clear, the bias and the 1 shot (7 cycles per sample). A fault
+// adds the status read and a separate fault clear write, and the clear must
+// be one the chip accepts so the probe recovers once the fault is gone.
+//
+// The simulated chip updates its registers when the conversion ends: every
+// read must come before the next 1 shot, and a fault that stays must show on
+// every sample. Clearing it after the 1 shot drops the fault that conversion
+// was latching, the probe then looks healthy one sample in two.
+
+#include "mbed.h"
+#include "max31865.h"
+#include <stdio.h>
+
+int max31865_session(void);
+
+namespace {
+
+const int SAMPLES = 100;
+const int BEFORE_SHADOW = 7;    // ClearFault r+w, EnableBias r+w, config r+w, RTD r
+const int HELD = 5;             // samples with the fault still there
+
+unsigned transactions(const max31865 &probe)
+{
+    return probe.ReadStats().Count() + probe.WriteStats().Count();
+}
+
+// one sample per conversion window, returns the chip select cycles it cost
+unsigned sample(max31865 &probe, bool snapshot)
+{
+    unsigned before = transactions(probe);
+    if (snapshot)
+    {
+        max31865_snapshot_t snap;
+        probe.ReadRTD(snap);
+    }
+    else
+    {
+        probe.ReadRTD();
+    }
+    unsigned cost = transactions(probe) - before;
+    wait_us(MAX31865_CONVERSION_US);
+    return cost;
+}
+
+}
+
+int max31865_session(void)
+{
+    int failures = 0;
+    long earlyBefore = sim::rtd_reads_in_conversion();
+    max31865 probe(PB_5, PB_4, PB_3, PB_6);
+    probe.Begin(MAX31865_3WIRE);
+    printf("Begin(): %u transactions\n", transactions(probe));
+    wait_us(MAX31865_CONVERSION_US);    // first conversion, started by Begin()
+
+    for (int mode = 0; mode < 2; mode++)
+    {
+        unsigned total = 0;
+        for (int i = 0; i < SAMPLES; i++) total += sample(probe, mode == 1);
+        double perSample = (double)total / SAMPLES;
+        bool ok = perSample == 2 && probe.Status() == MAX31865_STATUS_OK;
+        printf("%-20s %.2f transactions per sample (%d before the shadow register)  %s\n",
+               mode ? "ReadRTD(snapshot):" : "ReadRTD():", perSample, BEFORE_SHADOW, ok ? "ok" : "FAIL");
+        if (!ok) failures++;
+    }
+
+    // open probe: the fault shows up with its status read and clear, then goes away with the fault
+    for (int mode = 0; mode < 2; mode++)
+    {
+        sim::set_rtd_fault(MAX31865_FAULT_HIGHTHRESH);
+        unsigned cost = 0;
+        int n = 0;
+        while (probe.Status() == MAX31865_STATUS_OK && n++ < 3) cost = sample(probe, mode == 1);
+        max31865_status_t status = probe.Status();
+        int held = 0;
+        for (int i = 0; i < HELD; i++)
+        {
+            sample(probe, mode == 1);
+            if (probe.Status() == status) held++;
+        }
+
+        sim::set_rtd_fault(0);
+        n = 0;
+        while (probe.Status() != MAX31865_STATUS_OK && n++ < 3) sample(probe, mode == 1);
+        bool recovered = probe.Status() == MAX31865_STATUS_OK;
+
+        // snapshot: the status register comes with the burst, only the clear is added
+        unsigned expected = mode ? 3 : 4;
+        bool ok = status == MAX31865_STATUS_RTD_HIGH && cost == expected && held == HELD && recovered;
+        printf("%-20s fault %s in %u transactions, held %d / %d, %s  %s\n", mode ? "ReadRTD(snapshot):" : "ReadRTD():",
+               max31865::StatusName(status), cost, held, HELD, recovered ? "cleared" : "still latched",
+               ok ? "ok" : "FAIL");
+        if (!ok) failures++;
+    }
+
+    long early = sim::rtd_reads_in_conversion() - earlyBefore;
+    printf("reads during a conversion: %ld  %s\n", early, early ? "FAIL" : "ok");
+    if (early) failures++;
+
+    long ignored = sim::rtd_ignored_fault_clears();
+    printf("fault clears ignored by the chip: %ld  %s\n", ignored, ignored ? "FAIL" : "ok");
+    if (ignored) failures++;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,236 @@
+#ifndef SIM_MBED_H
+#define SIM_MBED_H
+
+// Host stand-ins for the parts of Mbed OS 5 used by the firmware.
+// Time is virtual (sim.h): Timer, EventQueue and thread_sleep_for all run
+// on the simulated clock, PwmOut drives the thermal model and SPI answers
+// like a MAX31865 wired to the simulated probe.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <functional>
+#include <vector>
+#include "sim.h"
+
+typedef int PinName;
+enum {
+    NC = -1,
+    PA_0, PA_1, PA_4, PA_5, PA_6, PA_7, PA_8, PA_9, PA_10, PA_11, PA_12,
+    PB_0, PB_1, PB_3, PB_4, PB_5, PB_6, PB_7, PB_8, PB_9, PB_10,
+    PC_0, PC_1, PC_7,
+    SERIAL_TX, SERIAL_RX, USBTX, USBRX
+};
+
+#define MBED_PACKED(x)                  x __attribute__((packed))
+#define DEVICE_I2C_ASYNCH               1       // the scd30 sampler runs on a simulated sensor (i2c_transport)
+
+#define I2C_EVENT_ERROR                 (1 << 1)
+#define I2C_EVENT_ERROR_NO_SLAVE        (1 << 2)
+#define I2C_EVENT_TRANSFER_COMPLETE     (1 << 3)
+#define I2C_EVENT_TRANSFER_EARLY_NACK   (1 << 4)
+#define I2C_EVENT_ALL                   (I2C_EVENT_ERROR | I2C_EVENT_TRANSFER_COMPLETE | I2C_EVENT_ERROR_NO_SLAVE | I2C_EVENT_TRANSFER_EARLY_NACK)
+#define EVENTS_EVENT_SIZE               64
+
+namespace mbed {
+
+template <typename F> class Callback;
+
+template <typename R, typename... A>
+class Callback<R(A...)> {
+    public:
+    Callback() {}
+    Callback(R (*f)(A...)) { if (f) fn = f; }
+    template <typename T, typename U>
+    Callback(U *obj, R (T::*method)(A...)) : fn([obj, method](A... a) { return (obj->*method)(a...); }) {}
+    R operator()(A... a) const { return fn(a...); }
+    R call(A... a) const { return fn(a...); }
+    explicit operator bool() const { return (bool)fn; }
+    private:
+    std::function<R(A...)> fn;
+};
+
+template <typename T, typename U, typename R, typename... A>
+Callback<R(A...)> callback(U *obj, R (T::*method)(A...)) { return Callback<R(A...)>(obj, method); }
+
+template <typename R, typename... A>
+Callback<R(A...)> callback(R (*f)(A...)) { return Callback<R(A...)>(f); }
+
+typedef Callback<void(int)> event_callback_t;
+
+}
+using namespace mbed;
+
+//-----------------------------------------------------------------------------
+// Time
+
+class Timer {
+    public:
+    Timer() : running(false), start_us(0), acc_us(0) {}
+    void start() { if (!running) { start_us = sim::now_us(); running = true; } }
+    void stop() { if (running) { acc_us += sim::now_us() - start_us; running = false; } }
+    void reset() { acc_us = 0; start_us = sim::now_us(); }
+    float read() { return elapsed() / 1e6f; }
+    int read_ms() { return (int)(elapsed() / 1000); }
+    int read_us() { return (int)elapsed(); }
+    uint64_t read_high_resolution_us() { return elapsed(); }
+    private:
+    bool running;
+    uint64_t start_us, acc_us;
+    uint64_t elapsed() { return acc_us + (running ? sim::now_us() - start_us : 0); }
+};
+
+inline void thread_sleep_for(uint32_t ms) { sim::advance_to(sim::now_us() + ms * 1000ull); }
+inline void wait_ms(int ms) { sim::advance_to(sim::now_us() + ms * 1000ull); }
+inline void wait_us(int us) { sim::advance_to(sim::now_us() + us); }
+
+inline void core_util_critical_section_enter() {}
+inline void core_util_critical_section_exit() {}
+
+class EventQueue {
+    public:
+    EventQueue(unsigned size = 0, unsigned char *buffer = 0) : next_id(1) {}
+
+    template <typename F, typename... A>
+    int call(F f, A... a) { return post(0, 0, f, a...); }
+
+    template <typename F, typename... A>
+    int call_in(int ms, F f, A... a) { return post(ms, 0, f, a...); }
+
+    template <typename F, typename... A>
+    int call_every(int ms, F f, A... a) { return post(ms, ms, f, a...); }
+
+    void cancel(int id);
+    void dispatch(int ms = -1);
+    unsigned tick() { return (unsigned)(sim::now_us() / 1000); }
+    void dispatch_forever() { dispatch(-1); sim::finish(); }
+
+    private:
+    struct event {
+        int id;
+        uint64_t due;
+        uint64_t period;
+        std::function<void()> fn;
+    };
+    std::vector<event> events;
+    int next_id;
+
+    template <typename F, typename... A>
+    int post(int ms, int period, F f, A... a)
+    {
+        event e;
+        e.id = next_id++;
+        e.due = sim::now_us() + ms * 1000ull;
+        e.period = period * 1000ull;
+        e.fn = [f, a...]() { f(a...); };
+        events.push_back(e);
+        return e.id;
+    }
+};
+
+//-----------------------------------------------------------------------------
+// I/O
+
+class DigitalOut {
+    public:
+    DigitalOut(PinName pin, int value = 0) : pin(pin), value(value) {}
+    void write(int v);
+    int read() { return value; }
+    DigitalOut &operator=(int v) { write(v); return *this; }
+    operator int() { return value; }
+    private:
+    PinName pin;
+    int value;
+};
+
+class PwmOut {
+    public:
+    PwmOut(PinName pin) : duty(0) {}
+    void period(float s) {}
+    void period_ms(int ms) {}
+    void write(float v) { duty = v < 0 ? 0 : (v > 1 ? 1 : v); sim::set_heater(duty); }
+    float read() { return duty; }
+    PwmOut &operator=(float v) { write(v); return *this; }
+    operator float() { return duty; }
+    private:
+    float duty;
+};
+
+// SPI bus: the selected DigitalOut pin decides which simulated chip answers,
+// each byte takes its 8 clock periods of virtual time
+class SPI {
+    public:
+    SPI(PinName mosi, PinName miso, PinName sclk) : hz(1000000) {}
+    void format(int bits, int mode = 0) {}
+    void frequency(int hz) { this->hz = hz; }
+    int write(int value);
+    int write(const char *tx, int tx_length, char *rx, int rx_length);
+    private:
+    int hz;
+};
+
+// Edge interrupt, its pin only moves through sim::pin_edge()
+class InterruptIn {
+    public:
+    InterruptIn(PinName pin);
+    ~InterruptIn();
+    void rise(Callback<void()> cb) { riseCb = cb; }
+    void fall(Callback<void()> cb) { fallCb = cb; }
+    int read() { return level; }
+    private:
+    friend void sim::pin_edge(int pin, bool rising);
+    PinName pin;
+    int level;
+    Callback<void()> riseCb, fallCb;
+};
+
+// I2C bus with nothing on it (no SCD30 in the thermal simulation): every address NACKs
+class I2C {
+    public:
+    I2C(PinName sda, PinName scl) {}
+    void frequency(int hz) {}
+    int write(int address, const char *data, int length, bool repeated = false) { return 1; }
+    int read(int address, char *data, int length, bool repeated = false) { return 1; }
+    int transfer(int address, const char *tx, int txLen, char *rx, int rxLen,
+                 const event_callback_t &cb, int event, bool repeated) { return 1; }
+};
+
+class SerialBase {
+    public:
+    enum IrqType { RxIrq = 0, TxIrq };
+    void baud(int rate) {}
+    int readable() { return 0; }
+    int writeable() { return 1; }
+    // the simulated UART is always empty: a TX callback drains immediately
+    void attach(Callback<void()> func, IrqType type = RxIrq) { if (type == TxIrq && func) func(); }
+};
+
+class RawSerial : public SerialBase {
+    public:
+    RawSerial(PinName tx, PinName rx, int baud = 9600) : console(tx == SERIAL_TX || tx == USBTX) {}
+    // only the pc port is echoed (-v), the other links carry binary frames
+    int putc(int c) { if (console && sim::verbose()) fputc(c, stdout); return c; }
+    int getc() { return 0; }
+    int puts(const char *s) { if (sim::verbose()) fputs(s, stdout); return 0; }
+    int printf(const char *format, ...)
+    {
+        if (!sim::verbose()) return 0;
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n;
+    }
+
+    private:
+    bool console;
+};
+
+class Serial : public RawSerial {
+    public:
+    Serial(PinName tx, PinName rx, int baud = 9600) : RawSerial(tx, rx, baud) {}
+};
+
+#endif
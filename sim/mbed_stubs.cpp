@@ -0,0 +1,255 @@
+#include "mbed.h"
+#include "rtd_table.h"
+#include <chrono>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// EventQueue: run the earliest event, advancing the plant to its due time
+
+void EventQueue::cancel(int id)
+{
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        if (events[i].id == id)
+        {
+            events.erase(events.begin() + i);
+            return;
+        }
+    }
+}
+
+void EventQueue::dispatch(int ms)
+{
+    uint64_t end = ms < 0 ? UINT64_MAX : sim::now_us() + ms * 1000ull;
+
+    while (!sim::stopped() && !events.empty())
+    {
+        size_t next = 0;
+        for (size_t i = 1; i < events.size(); i++)
+        {
+            if (events[i].due < events[next].due) next = i;
+        }
+        if (events[next].due > end) break;
+
+        event e = events[next];
+        if (e.period)
+        {
+            events[next].due += e.period;
+        }
+        else
+        {
+            events.erase(events.begin() + next);
+        }
+
+        sim::advance_to(e.due);
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        e.fn();
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        sim::record_callback_ns(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    }
+    if (ms >= 0 && !sim::stopped()) sim::advance_to(end);
+}
+
+//-----------------------------------------------------------------------------
+// MAX31865 register model, one per chip select pin
+
+namespace {
+
+const double RTD_R0 = 100.0;
+const double RTD_RREF = 430.0;
+
+struct max31865_chip {
+    int pin;
+    uint8_t reg[8];
+    int addr;
+    bool write;
+    bool addressPhase;
+    uint64_t converting;    // end of the running 1 shot conversion
+    bool pending;           // registers not yet updated with it
+    long code;              // its result
+};
+
+std::vector<max31865_chip> chips;
+int selected = NC;
+long readsInConversion = 0;
+long ignoredFaultClears = 0;
+long restartedConversions = 0;
+int injectedFault = 0;
+
+max31865_chip &chip(int pin)
+{
+    for (size_t i = 0; i < chips.size(); i++)
+    {
+        if (chips[i].pin == pin) return chips[i];
+    }
+    max31865_chip c;
+    memset(&c, 0, sizeof(c));
+    c.pin = pin;
+    chips.push_back(c);
+    return chips.back();
+}
+
+// 1 shot written: the RTD is sampled now, a fault found while the bias is
+// applied latches in the status register at once
+void start_conversion(max31865_chip &c, bool filter50Hz)
+{
+    if (c.pending && sim::now_us() < c.converting) restartedConversions++;
+    double t = sim::probe_temperature(c.pin);
+    double r = RTD_R0 * (1 + RTD_CVD_A * t + RTD_CVD_B * t * t);
+    long code = lround(r / RTD_RREF * RTD_CODE_RANGE);
+    if (code < 0) code = 0;
+    if (code > RTD_CODE_RANGE - 1) code = RTD_CODE_RANGE - 1;
+    c.code = code;
+    c.reg[7] |= injectedFault;
+    c.converting = sim::now_us() + (filter50Hz ? 62500 : 52000);
+    c.pending = true;
+}
+
+// end of the conversion: RTD registers updated, the LSB set while any status
+// bit is latched. A fault clear written before this point is lost for it
+void complete_conversion(max31865_chip &c)
+{
+    if (!c.pending || sim::now_us() < c.converting) return;
+    c.reg[1] = (c.code << 1) >> 8;
+    c.reg[2] = (c.code << 1) & 0xFF;
+    if (c.reg[7]) c.reg[2] |= 1;
+    c.pending = false;
+}
+
+int transfer(int value)
+{
+    if (selected == NC) return 0xFF;
+    max31865_chip &c = chip(selected);
+
+    if (c.addressPhase)
+    {
+        c.addr = value & 0x7F;
+        c.write = value & 0x80;
+        c.addressPhase = false;
+        return 0xFF;
+    }
+
+    complete_conversion(c);
+    int ret = 0xFF;
+    if (c.write)
+    {
+        if (c.addr == 0)
+        {
+            // fault clear, ignored when D5 (1 shot), D3 or D2 is 1 in the same write
+            if ((value & 0x02) && !(value & 0x2C))
+            {
+                c.reg[7] = 0;
+                c.reg[2] &= ~1;
+            }
+            else if (value & 0x02)
+            {
+                ignoredFaultClears++;
+            }
+            if (value & 0x20) start_conversion(c, value & 0x01);   // registers updated when it ends
+            value &= ~0x22;                     // self clearing bits
+        }
+        if (c.addr < 8) c.reg[c.addr] = value;
+    }
+    else if (c.addr < 8)
+    {
+        ret = c.reg[c.addr];
+        if ((c.addr == 1 || c.addr == 2 || c.addr == 7) && sim::now_us() < c.converting) readsInConversion++;
+    }
+    c.addr++;
+    return ret;
+}
+
+}
+
+void DigitalOut::write(int v)
+{
+    value = v;
+    if (sim::set_pin(pin, v)) return;
+    if (v == 0)
+    {
+        selected = pin;
+        chip(pin).addressPhase = true;
+    }
+    else if (selected == pin)
+    {
+        selected = NC;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// InterruptIn
+
+namespace {
+
+std::vector<InterruptIn *> interrupts;
+
+}
+
+InterruptIn::InterruptIn(PinName pin) : pin(pin), level(0)
+{
+    interrupts.push_back(this);
+}
+
+InterruptIn::~InterruptIn()
+{
+    for (size_t i = 0; i < interrupts.size(); i++)
+    {
+        if (interrupts[i] == this)
+        {
+            interrupts.erase(interrupts.begin() + i);
+            return;
+        }
+    }
+}
+
+void sim::pin_edge(int pin, bool rising)
+{
+    for (size_t i = 0; i < interrupts.size(); i++)
+    {
+        InterruptIn *in = interrupts[i];
+        if (in->pin != pin) continue;
+        in->level = rising;
+        Callback<void()> &cb = rising ? in->riseCb : in->fallCb;
+        if (cb) cb();
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+long sim::rtd_restarted_conversions()
+{
+    return restartedConversions;
+}
+
+long sim::rtd_reads_in_conversion()
+{
+    return readsInConversion;
+}
+
+long sim::rtd_ignored_fault_clears()
+{
+    return ignoredFaultClears;
+}
+
+void sim::set_rtd_fault(int bits)
+{
+    injectedFault = bits;
+}
+
+int SPI::write(int value)
+{
+    sim::advance_to(sim::now_us() + 8000000 / hz);
+    return transfer(value);
+}
+
+int SPI::write(const char *tx, int tx_length, char *rx, int rx_length)
+{
+    int n = tx_length > rx_length ? tx_length : rx_length;
+    sim::advance_to(sim::now_us() + 8000000ull * n / hz);
+    for (int i = 0; i < n; i++)
+    {
+        int r = transfer(i < tx_length ? (uint8_t)tx[i] : 0xFF);
+        if (i < rx_length) rx[i] = r;
+    }
+    return n;
+}
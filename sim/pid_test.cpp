@@ -0,0 +1,160 @@
+// pid unit tests and benchmark (./brew_sim -t pid): each property of the
+// pid.h header comment checked on pid<float> and pid<q16_16>, then the
+// Q16.16 controller against the float one on a simulated tank, and the cpu
+// time per Update() of both.
+
+#include "mbed.h"
+#include "pid.h"
+#include "fixed_point.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+int pid_session(void);
+
+namespace {
+
+const int PERIODS = 1000000;
+const int RUNS = 5;
+
+int failures = 0;
+float sink;
+
+void check(const char *type, const char *name, bool ok, float value)
+{
+    printf("%-7s %-44s %9.4f  %s\n", type, name, value, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+template <typename T>
+float f(T v)
+{
+    return (float)v;
+}
+
+template <typename T>
+void unit_tests(const char *type, float eps)
+{
+    // proportional only and output clamp
+    {
+        pid<T> p(2.0f, 0, 0, 1.0f);
+        p.SetSetpoint(T(10.0f));
+        float u = f(p.Update(T(9.8f)));
+        check(type, "P only: 2 x (10 - 9.8)", fabs(u - 0.4f) < eps, u);
+        u = f(p.Update(T(0.0f)));
+        check(type, "clamped to outMax", u == 1.0f, u);
+        u = f(p.Update(T(20.0f)));
+        check(type, "clamped to outMin", u == 0.0f, u);
+    }
+
+    // anti-windup: an hour saturated must not wind the integral past outMax
+    {
+        pid<T> p(0.5f, 0.01f, 0, 1.0f);
+        p.SetSetpoint(T(60.0f));
+        for (int i = 0; i < 3600; i++) p.Update(T(20.0f));
+        float integ = f(p.Integral());
+        check(type, "integral after 1 h saturated", integ <= 1.0f + eps, integ);
+        // back above the setpoint: the output leaves saturation at once
+        float u = f(p.Update(T(61.0f)));
+        check(type, "unsaturated one period after the crossing", u < 1.0f, u);
+    }
+
+    // derivative on measurement: a setpoint step gives no kick, a measurement step does
+    {
+        pid<T> p(0, 0, 2.0f, 1.0f, 3.0f);
+        p.SetSetpoint(T(50.0f));
+        p.Update(T(40.0f));
+        p.SetSetpoint(T(60.0f));
+        p.Update(T(40.0f));
+        float d = f(p.Derivative());
+        check(type, "no derivative kick on a setpoint step", fabs(d) < eps, d);
+        p.Update(T(41.0f));
+        d = f(p.Derivative());
+        check(type, "measurement step: -kd / (tf + dt)", fabs(d + 0.5f) < eps, d);
+        p.Update(T(41.0f));
+        d = f(p.Derivative());
+        check(type, "filtered: x tf / (tf + dt) next period", fabs(d + 0.375f) < eps, d);
+    }
+
+    // bumpless setpoint and gain changes: only the new integral step shows
+    {
+        pid<T> p(0.1f, 0.002f, 0, 1.0f);
+        p.SetSetpoint(T(50.0f));
+        for (int i = 0; i < 100; i++) p.Update(T(48.0f));
+        float before = f(p.Output());
+        p.SetSetpoint(T(53.0f));
+        float after = f(p.Update(T(48.0f)));
+        check(type, "setpoint +3: output step <= ki dt x e", fabs(after - before) <= 0.002f * 5 + eps, after - before);
+        before = after;
+        p.SetGains(0.3f, 0.002f, 0);
+        after = f(p.Update(T(48.0f)));
+        check(type, "Kp x3: output step <= ki dt x e", fabs(after - before) <= 0.002f * 5 + eps, after - before);
+    }
+
+    // restart from a plant state: the first output is the one asked for
+    {
+        pid<T> p(0.5f, 0.002f, 0, 1.0f);
+        p.SetSetpoint(T(63.0f));
+        p.Reset(T(62.0f), T(0.3f));
+        float u = f(p.Update(T(62.0f)));
+        check(type, "Reset(u = 0.3) then same measurement", fabs(u - 0.302f) < eps, u);
+    }
+}
+
+// first order tank, 1 s period
+float tank_step(float t, float u)
+{
+    return t + (u * 2.0f - (t - 20) * 0.01f) * 0.05f;
+}
+
+double now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+int pid_session(void)
+{
+    failures = 0;
+    unit_tests<float>("float", 1e-5f);
+    unit_tests<q16_16>("q16_16", 1e-3f);
+
+    // closed loop, Q16.16 against float: same trajectory within the Q16.16 resolution
+    pid<float> pf(0.5f, 0.002f, 2.0f, 1.0f, 5.0f);
+    pid<q16_16> pq(0.5f, 0.002f, 2.0f, 1.0f, 5.0f);
+    pf.SetSetpoint(63.0f);
+    pq.SetSetpoint(q16_16(63.0f));
+    float tf = 20, tq = 20, worst = 0;
+    for (int i = 0; i < 20000; i++)
+    {
+        tf = tank_step(tf, pf.Update(tf));
+        tq = tank_step(tq, (float)pq.Update(q16_16(tq)));
+        if (fabs(tf - tq) > worst) worst = fabs(tf - tq);
+    }
+    check("both", "closed loop 5.5 h, max tank gap float/Q16.16 (C)", worst < 0.05f, worst);
+
+    // best of RUNS
+    double floatNs = 1e9, fixedNs = 1e9;
+    for (int r = 0; r < RUNS; r++)
+    {
+        double t0 = now_ns();
+        for (int k = 0; k < PERIODS; k++)
+        {
+            sink += pf.Update(62.0f + (k & 15) * 0.1f);
+        }
+        double t = (now_ns() - t0) / PERIODS;
+        if (t < floatNs) floatNs = t;
+
+        t0 = now_ns();
+        for (int k = 0; k < PERIODS; k++)
+        {
+            sink += (float)pq.Update(q16_16::FromRaw((62 << 16) + (k & 15) * 6554));
+        }
+        t = (now_ns() - t0) / PERIODS;
+        if (t < fixedNs) fixedNs = t;
+    }
+    printf("Update()  float: %.2f ns  q16_16: %.2f ns\n", floatNs, fixedNs);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,68 @@
+// Probe array benchmark (./brew_sim -m): aggregate RTD sample rate against
+// the number of MAX31865 sharing one SPI bus, in virtual time. SPI bytes
+// take their clock periods, conversion waits go through wait_us().
+//
+// sequential: each probe starts, waits for and reads its own conversion
+// array:      max31865_array, all conversions overlapped in one window
+//
+// Exit code 1 if a register is read or a 1 shot is written while the
+// conversion of that chip is still running (Begin() starts one on each).
+
+#include "mbed.h"
+#include "max31865_array.h"
+#include <stdio.h>
+
+int probe_array_session(void);
+
+namespace {
+
+const int SWEEPS = 20;
+const PinName CS_PINS[MAX31865_ARRAY_MAX] = { PA_11, PA_12, PB_0, PB_1, PB_8, PB_9, PB_10, PC_0 };
+
+}
+
+int probe_array_session(void)
+{
+    int mismatches = 0;
+    printf("probes  sequential(ms)  rate(S/s)  array(ms)  rate(S/s)  speedup\n");
+    for (int n = 1; n <= MAX31865_ARRAY_MAX; n++)
+    {
+        max31865_array probes(PB_5, PB_4, PB_3, CS_PINS, n);
+        probes.Begin(MAX31865_3WIRE);
+        int rtd[MAX31865_ARRAY_MAX];
+
+        uint64_t t0 = sim::now_us();
+        for (int s = 0; s < SWEEPS; s++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                probes.Probe(i).StartConversion();
+                wait_us(MAX31865_CONVERSION_US);
+                rtd[i] = probes.Probe(i).ReadConversion();
+            }
+        }
+        double sequential = (sim::now_us() - t0) / 1000.0 / SWEEPS;
+
+        t0 = sim::now_us();
+        for (int s = 0; s < SWEEPS; s++)
+        {
+            probes.ReadRTD(rtd);
+        }
+        double array = (sim::now_us() - t0) / 1000.0 / SWEEPS;
+
+        // every probe sits in the same water
+        for (int i = 1; i < n; i++)
+        {
+            if (rtd[i] != rtd[0]) mismatches++;
+        }
+
+        printf("%6d  %14.2f  %9.1f  %9.2f  %9.1f  %6.2fx\n", n, sequential, n * 1000 / sequential,
+               array, n * 1000 / array, sequential / array);
+    }
+
+    long early = sim::rtd_reads_in_conversion();
+    long restarted = sim::rtd_restarted_conversions();
+    printf("reads during a conversion: %ld, conversions restarted: %ld, probe mismatches: %d\n", early, restarted,
+           mismatches);
+    return early || restarted || mismatches ? 1 : 0;
+}
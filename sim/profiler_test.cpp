@@ -0,0 +1,126 @@
+// profiler check and benchmark (./brew_sim -t profiler):
+//
+//  - profile_zone statistics and log2 buckets on known durations, up to the
+//    largest uint32_t tick count
+//  - zones listed in declaration order after the firmware ones
+//  - Print() on every buffer size: always terminated, never past the end
+//  - profile_scope and profile_period against busy waits on the host clock
+//  - cost of one scope (ns)
+
+#include "mbed.h"
+#include "profiler.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+int profiler_session(void);
+
+namespace {
+
+const int SCOPES = 1000000;
+const int RUNS = 5;
+const uint32_t WAIT_NS = 2000000;
+const uint32_t PERIOD_US = 2000;
+
+int failures = 0;
+
+// zones link themselves in a list for good: static, as in the firmware
+profile_zone Zone_a("test a");
+profile_zone Zone_b("test b");
+profile_zone Zone_bucket("test bucket");
+profile_period Period_test("periode test", PERIOD_US);
+
+void check(const char *name, bool ok, double value)
+{
+    printf("%-52s %14.1f  %s\n", name, value, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// busy wait on the profiler clock, until ticks after start
+void spin_until(uint32_t start, uint32_t ticks)
+{
+    while (cycle_counter::Now() - start < ticks) {}
+}
+
+}
+
+int profiler_session(void)
+{
+    failures = 0;
+
+    // statistics and buckets: 0 in bucket 0, 2^(i-1) .. 2^i - 1 in bucket i
+    profile_zone &z = Zone_a;
+    z.Reset();
+    const uint32_t durations[] = { 0, 1, 2, 3, 4, 1000, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF };
+    const int buckets[] = { 0, 1, 2, 2, 3, 10, 31, 31, 31 };
+    long wrong = 0;
+    for (int i = 0; i < 9; i++)
+    {
+        Zone_bucket.Reset();
+        Zone_bucket.Add(durations[i]);
+        if (Zone_bucket.Bucket(buckets[i]) != 1) wrong++;
+        z.Add(durations[i]);
+    }
+    check("log2 bucket of 0 .. 0xFFFFFFFF ticks, wrong", wrong == 0, wrong);
+    check("min", z.Min() == 0, z.Min());
+    check("max", z.Max() == 0xFFFFFFFF, z.Max());
+    uint64_t sum = 0;
+    for (int i = 0; i < 9; i++) sum += durations[i];
+    check("mean (64 bit sum)", z.Mean() == (uint32_t)(sum / 9), z.Mean());
+
+    // list order: the firmware zones, then the ones above
+    profile_zone *p = profile_zone::First();
+    while (p && p != &Zone_a) p = p->Next();
+    check("zones in declaration order", p && p->Next() == &Zone_b, 0);
+
+    // Print() truncation on every size
+    char line[PROFILER_LINE_SIZE + 8];
+    wrong = 0;
+    int full = z.Print(line, PROFILER_LINE_SIZE);
+    for (int size = 1; size <= PROFILER_LINE_SIZE; size++)
+    {
+        memset(line, '#', sizeof(line));
+        int n = z.Print(line, size);
+        if (n < 0 || n >= size || line[n] != 0 || line[size] != '#') wrong++;
+    }
+    check("Print() sizes 1 .. PROFILER_LINE_SIZE past the end", wrong == 0, wrong);
+    check("full line fits PROFILER_LINE_SIZE", full < PROFILER_LINE_SIZE - 1, full);
+
+    // a scope around a 2 ms busy wait
+    Zone_b.Reset();
+    for (int i = 0; i < 5; i++)
+    {
+        PROFILE_SCOPE(Zone_b);
+        spin_until(cycle_counter::Now(), WAIT_NS);
+    }
+    check("scope around 2 ms: min (us)", Zone_b.Min() >= WAIT_NS, profile_zone::Microseconds(Zone_b.Min()));
+
+    // period tracker: nominal, 0.5 ms late, 0.5 ms early
+    profile_period &period = Period_test;
+    uint32_t t0 = cycle_counter::Now();
+    const uint32_t ticks[] = { 0, 2000000, 4500000, 6000000, 8000000 };
+    for (int i = 0; i < 5; i++)
+    {
+        spin_until(t0, ticks[i]);
+        period.Tick();
+    }
+    float late = profile_zone::Microseconds(period.Late()), early = profile_zone::Microseconds(-period.Early());
+    check("period: late (us), 500 expected", late > 400 && late < 1000, late);
+    check("period: early (us), 500 expected", early > 0 && early < 600, early);
+    check("period: 4 deviations recorded", period.Zone().Count() == 4, period.Zone().Count());
+
+    // cost of an empty scope, best of RUNS
+    double best = 1e9;
+    for (int r = 0; r < RUNS; r++)
+    {
+        uint32_t start = cycle_counter::Now();
+        for (int i = 0; i < SCOPES; i++)
+        {
+            PROFILE_SCOPE(Zone_a);
+        }
+        double ns = (double)(cycle_counter::Now() - start) / SCOPES;
+        if (ns < best) best = ns;
+    }
+    printf("profile_scope: %.1f ns, %u bytes per zone\n", best, (unsigned)sizeof(profile_zone));
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,5 @@
+// The firmware, unmodified, built against the stand-ins of sim/mbed.h.
+// Its main() becomes regulation_main() so the harness can run it.
+#define main regulation_main
+#include "../Regulation_temperature.cpp"
+#undef main
@@ -0,0 +1,176 @@
+// relay_output energy test (./brew_sim -o): for a range of duties, and a
+// slowly varying one, the on time seen on the relay pin over 200 windows
+// must match the requested on time within one minimum pulse, and no pulse
+// or gap may be shorter than the minimums, and DeliveredUs() must agree with
+// the pin. The zero-cross mode also gets a 50 Hz mains on its input and must
+// only switch on zero crossings. Then a Shutdown() in the middle of a pulse,
+// timed and zero-cross: only the part actually served counts as delivered.
+
+#include "mbed.h"
+#include "relay_output.h"
+#include <math.h>
+#include <stdio.h>
+
+int relay_output_session(void);
+
+namespace {
+
+const int WINDOW_MS = 5000;
+const int MIN_MS = 500;
+const int WINDOWS = 200;
+const PinName RELAY_PIN = PA_8;
+const PinName ZERO_CROSS_PIN = PB_9;
+
+// pin observer, one sample per ms
+struct pin_watch {
+    relay_output *relay;
+    int level;
+    long onMs;
+    long shortestOn, shortestOff;
+    long lastChange;
+    bool offGrid;              // a change away from a zero crossing
+    bool zeroCross;
+    long now;
+};
+
+pin_watch watch;
+
+void sample()
+{
+    int level = watch.relay->State();
+    if (level != watch.level)
+    {
+        long len = watch.now - watch.lastChange;
+        if (watch.lastChange >= 0)
+        {
+            long &shortest = watch.level ? watch.shortestOn : watch.shortestOff;
+            if (len < shortest) shortest = len;
+        }
+        if (watch.zeroCross && watch.now % 10 > 1) watch.offGrid = true;
+        watch.lastChange = watch.now;
+        watch.level = level;
+    }
+    if (level) watch.onMs++;
+    watch.now++;
+}
+
+bool mainsRising = false;
+
+void mains_edge()
+{
+    mainsRising = !mainsRising;
+    sim::pin_edge(ZERO_CROSS_PIN, mainsRising);
+}
+
+// duty < 0: slow sine between 0 and 0.3 (a PID holding a rest)
+float duty_at(float duty, long ms)
+{
+    if (duty >= 0) return duty;
+    return 0.15f + 0.15f * sinf(ms * 2e-5f);
+}
+
+bool run(const char *name, float duty, bool zeroCross)
+{
+    EventQueue queue(64 * EVENTS_EVENT_SIZE);
+    int window = zeroCross ? 1000 : WINDOW_MS;
+    int minimum = zeroCross ? 20 : MIN_MS;
+    relay_output relay(RELAY_PIN, &queue, window, minimum, minimum, zeroCross ? ZERO_CROSS_PIN : NC, 50);
+
+    watch.relay = &relay;
+    watch.level = 0;
+    watch.onMs = watch.now = 0;
+    watch.shortestOn = watch.shortestOff = 1L << 30;
+    watch.lastChange = -1;
+    watch.offGrid = false;
+    watch.zeroCross = zeroCross;
+
+    // the sampler and the mains are posted first: at equal times they run before the windows
+    queue.call_every(1, sample);
+    if (zeroCross) queue.call_every(10, mains_edge);
+
+    // the regulation writes once per second, just before a window starts when they coincide
+    int step = window < 1000 ? window : 1000;
+    long end = (long)WINDOWS * window;
+    double requested = 0;
+    float d = duty_at(duty, 0);
+    relay = d;
+    relay.Start();
+    while (watch.now < end - 1)
+    {
+        float clamped = d < 0 ? 0 : (d > 1 ? 1 : d);
+        long next = watch.now + step < end ? watch.now + step : end;
+        requested += clamped * (next - watch.now) / 1000.0;
+        queue.dispatch(next - watch.now - 1);
+        d = next < end ? duty_at(duty, next) : 0;
+        relay = d;
+        queue.dispatch(1);
+    }
+    queue.dispatch(window + 1);
+
+    double delivered = watch.onMs / 1000.0;
+    double counted = relay.DeliveredUs() / 1e6;
+    double error = delivered - requested;
+    bool partial = watch.shortestOn < (1L << 30);
+    bool ok = fabs(error) <= minimum / 1000.0 + 0.002 && fabs(counted - delivered) <= 0.002
+              && (!partial || (watch.shortestOn >= minimum && watch.shortestOff >= minimum)) && !watch.offGrid;
+    printf("%-14s %7.1f  %9.2f  %9.2f  %+7.3f  %8u  %6ld  %6ld  %s\n", name, requested, delivered,
+           counted, error, relay.Switches(), partial ? watch.shortestOn : 0,
+           partial && watch.shortestOff < (1L << 30) ? watch.shortestOff : 0, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// half duty, cut after cutMs of a pulse of half a window
+bool shutdown_run(const char *name, bool zeroCross, long cutMs)
+{
+    EventQueue queue(64 * EVENTS_EVENT_SIZE);
+    int window = zeroCross ? 1000 : WINDOW_MS;
+    int minimum = zeroCross ? 20 : MIN_MS;
+    relay_output relay(RELAY_PIN, &queue, window, minimum, minimum, zeroCross ? ZERO_CROSS_PIN : NC, 50);
+
+    watch.relay = &relay;
+    watch.level = 0;
+    watch.onMs = watch.now = 0;
+    watch.shortestOn = watch.shortestOff = 1L << 30;
+    watch.lastChange = -1;
+    watch.offGrid = false;
+    watch.zeroCross = zeroCross;
+    queue.call_every(1, sample);
+    if (zeroCross) queue.call_every(10, mains_edge);
+
+    relay = 0.5f;
+    relay.Start();
+    queue.dispatch(cutMs);
+    relay.Shutdown();
+    queue.dispatch(2 * window);
+
+    double delivered = watch.onMs / 1000.0;
+    double counted = relay.DeliveredUs() / 1e6;
+    bool ok = fabs(counted - delivered) <= 0.002 && delivered < cutMs / 1000.0 + 0.002 && !relay.State();
+    printf("%-14s cut at %ld ms of a %d ms pulse  pin: %.3f s  DeliveredUs: %.3f s  %s\n", name, cutMs,
+           window / 2, delivered, counted, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+}
+
+int relay_output_session(void)
+{
+    struct { const char *name; float duty; bool zc; } cases[] = {
+        { "0", 0, false }, { "0.02", 0.02f, false }, { "0.05", 0.05f, false }, { "0.09", 0.09f, false },
+        { "0.3", 0.3f, false }, { "0.5", 0.5f, false }, { "0.91", 0.91f, false }, { "0.95", 0.95f, false },
+        { "0.99", 0.99f, false }, { "1", 1, false }, { "1.5 (clamp)", 1.5f, false }, { "sine 0..0.3", -1, false },
+        { "zc 0.013", 0.013f, true }, { "zc 0.37", 0.37f, true }, { "zc sine", -1, true },
+    };
+    int n = sizeof(cases) / sizeof(cases[0]), failures = 0;
+
+    printf("duty           requested  delivered    counted  error(s)  switches  on(ms)  off(ms)\n");
+    for (int i = 0; i < n; i++)
+    {
+        if (!run(cases[i].name, cases[i].duty, cases[i].zc)) failures++;
+    }
+    printf("%d / %d cases within one minimum pulse\n", n - failures, n);
+
+    if (!shutdown_run("shutdown", false, 1000)) failures++;
+    if (!shutdown_run("zc shutdown", true, 200)) failures++;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+// RTD fault injection (./brew_sim -f): each MAX31865 fault code is set on
+// the simulated chip while Regulation_temperature.cpp runs. The conversion
+// started after the fault latches it and is read one period later: in that
+// period the firmware must open the relay with the right decoded status, keep
+// it open while the fault stays, and resume once the probe is back. A healthy
+// read costs one register read, a faulty one exactly one more.
+
+#include "mbed.h"
+#include "max31865.h"
+#include "relay_output.h"
+#include <stdio.h>
+
+int rtd_fault_session(void);
+
+// firmware under test (regulation_under_test.cpp)
+extern max31865 PT100;
+extern relay_output Relais;
+void Regulation(void);
+
+namespace {
+
+struct fault_case {
+    int bits;
+    max31865_status_t expected;
+};
+
+const fault_case CASES[] = {
+    { MAX31865_FAULT_HIGHTHRESH, MAX31865_STATUS_RTD_HIGH },
+    { MAX31865_FAULT_LOWTHRESH, MAX31865_STATUS_RTD_LOW },
+    { MAX31865_FAULT_REFINLOW, MAX31865_STATUS_REFIN_HIGH },
+    { MAX31865_FAULT_REFINHIGH, MAX31865_STATUS_REFIN_LOW },
+    { MAX31865_FAULT_RTDINLOW, MAX31865_STATUS_RTDIN_LOW },
+    { MAX31865_FAULT_OVUV, MAX31865_STATUS_OVUV },
+    { MAX31865_FAULT_HIGHTHRESH | MAX31865_FAULT_REFINHIGH, MAX31865_STATUS_RTD_HIGH },
+};
+const int CASE_COUNT = sizeof(CASES) / sizeof(CASES[0]);
+
+// one control period, returns the register reads it cost
+unsigned period()
+{
+    unsigned reads = PT100.ReadStats().Count();
+    wait_ms(1000);
+    Regulation();
+    return PT100.ReadStats().Count() - reads;
+}
+
+}
+
+int rtd_fault_session(void)
+{
+    int failures = 0;
+    PT100.Begin(MAX31865_3WIRE);
+    for (int i = 0; i < 3; i++) period();
+
+    printf("fault  status               heater  reads  resumed\n");
+    for (int i = 0; i < CASE_COUNT; i++)
+    {
+        const fault_case &c = CASES[i];
+        unsigned healthyReads = period();
+        bool heating = Relais.read() > 0;
+
+        sim::set_rtd_fault(c.bits);
+        bool late = period() && PT100.Status() == MAX31865_STATUS_OK;   // conversion started before the fault
+        unsigned faultReads = period();
+        max31865_status_t status = PT100.Status();
+        int bits = PT100.FaultBits();
+        float heater = Relais.read();
+        int level = Relais.State();
+        bool held = period() && PT100.Status() == c.expected && Relais.read() == 0 && Relais.State() == 0;
+
+        sim::set_rtd_fault(0);
+        period();   // conversion started with the fault still there
+        period();
+        bool resumed = PT100.Status() == MAX31865_STATUS_OK && Relais.read() > 0;
+
+        bool ok = heating && late && status == c.expected && bits == c.bits && heater == 0 && level == 0 && held
+                  && healthyReads == 1 && faultReads == 2 && resumed;
+        printf(" 0x%02X  %-19s  %6.2f  %u + %u  %-7s  %s\n", c.bits, max31865::StatusName(status), heater,
+               healthyReads, faultReads - healthyReads, resumed ? "yes" : "no", ok ? "ok" : "FAIL");
+        if (!ok) failures++;
+    }
+
+    printf("%d / %d fault codes handled\n", CASE_COUNT - failures, CASE_COUNT);
+    return failures ? 1 : 0;
+}
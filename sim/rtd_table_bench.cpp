@@ -0,0 +1,126 @@
+// RTD table check and benchmark (./brew_sim -t rtd_table): every 15 bit
+// code of the mash range (0..110 degC) converted by rtd_table<7> and
+// rtd_table<9> against the exact Callendar-Van Dusen solution, and the cpu
+// time per conversion against the float formula of the original
+// Temperature() (R = 0.365 T + 100, float divisions) and against an exact
+// float conversion (quadratic Callendar-Van Dusen, one square root).
+
+#include "mbed.h"
+#include "rtd_table.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+int rtd_table_session(void);
+
+namespace {
+
+const double RREF = 430.0;
+const double R0 = 100.0;
+const double T_LOW = 0;
+const double T_HIGH = 110;
+const double CODE_STEP = RREF / RTD_CODE_RANGE / (R0 * RTD_CVD_A);  // degC per RTD code
+const double MAX_ERROR = CODE_STEP / 2;
+const int CONVERSIONS = 1000000;
+const int RUNS = 5;
+
+constexpr rtd_table<7> table7(RREF, R0);
+constexpr rtd_table<9> table9(RREF, R0);
+
+float sinkF;
+int32_t sinkI;
+
+// Temperature() before the table
+float linear_fit(int code)
+{
+    float ratio = code;
+    ratio /= 32768;
+    float r = 430.0f * ratio;
+    return (r - 100) / 0.365f;
+}
+
+// exact above 0 degC, float
+float cvd_float(int code)
+{
+    float r = 430.0f * code / 32768;
+    const float a = RTD_CVD_A, b = RTD_CVD_B;
+    return (-a + sqrtf(a * a - 4 * b * (1 - r / 100.0f))) / (2 * b);
+}
+
+int code_of(double t)
+{
+    double r = R0 * (1 + RTD_CVD_A * t + RTD_CVD_B * t * t);
+    return (int)(r / RREF * RTD_CODE_RANGE);
+}
+
+double exact(int code)
+{
+    return rtd_table<>::Solve(RREF * code / RTD_CODE_RANGE / R0, RTD_CVD_A, RTD_CVD_B, RTD_CVD_C);
+}
+
+double now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+int rtd_table_session(void)
+{
+    int first = code_of(T_LOW), last = code_of(T_HIGH) + 1;
+    double err7 = 0, err9 = 0, errFit = 0, errCvd = 0;
+    for (int code = first; code <= last; code++)
+    {
+        double t = exact(code);
+        double e7 = fabs(table7.CentiDegrees(code) * 0.01 - t);
+        double e9 = fabs(table9.CentiDegrees(code) * 0.01 - t);
+        double eFit = fabs(linear_fit(code) - t);
+        if (e7 > err7) err7 = e7;
+        if (e9 > err9) err9 = e9;
+        if (eFit > errFit) errFit = eFit;
+        double eCvd = fabs(cvd_float(code) - t);
+        if (eCvd > errCvd) errCvd = eCvd;
+    }
+
+    bool ok = err7 <= MAX_ERROR && err9 <= MAX_ERROR;
+    printf("codes %d..%d (%.0f..%.0f C), max error against Callendar-Van Dusen:\n", first, last, T_LOW, T_HIGH);
+    printf("  rtd_table<7> (%d entries): %.4f C\n", rtd_table<7>::SIZE, err7);
+    printf("  rtd_table<9> (%d entries):  %.4f C\n", rtd_table<9>::SIZE, err9);
+    printf("  exact float:                %.4f C\n", errCvd);
+    printf("  linear fit 0.365 T + 100:   %.2f C (calibration of the original program)\n", errFit);
+    printf("table error within half a code (%.4f C): %s\n", MAX_ERROR, ok ? "ok" : "FAIL");
+
+    // best of RUNS over the mash range codes
+    double fitNs = 1e9, cvdNs = 1e9, tableNs = 1e9;
+    int span = last - first;
+    for (int r = 0; r < RUNS; r++)
+    {
+        double t0 = now_ns();
+        for (int k = 0; k < CONVERSIONS; k++)
+        {
+            sinkF += linear_fit(first + k % span);
+        }
+        double t = (now_ns() - t0) / CONVERSIONS;
+        if (t < fitNs) fitNs = t;
+
+        t0 = now_ns();
+        for (int k = 0; k < CONVERSIONS; k++)
+        {
+            sinkF += cvd_float(first + k % span);
+        }
+        t = (now_ns() - t0) / CONVERSIONS;
+        if (t < cvdNs) cvdNs = t;
+
+        t0 = now_ns();
+        for (int k = 0; k < CONVERSIONS; k++)
+        {
+            sinkI += table7.CentiDegrees(first + k % span);
+        }
+        t = (now_ns() - t0) / CONVERSIONS;
+        if (t < tableNs) tableNs = t;
+    }
+    printf("conversion  linear fit: %.2f ns  exact float: %.2f ns  table: %.2f ns\n", fitNs, cvdNs, tableNs);
+    printf("(host FPU: on a Cortex-M0/M3 every float operation above is a library call)\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+// scd30 decode check and benchmark (./brew_sim -t scd30_decode):
+//
+//  - random READ_MEAS replies (any float bits, bytes >= 0x80 included):
+//    decodeFrame() and decodeFrames() give the same values as the scdSTR
+//    path that readMeasurement() used before the typed API
+//  - a bad CRC in word n is reported as SCDcrcERRORv<n>
+//  - ready status, article code and serial number decoded through the
+//    driver with bytes >= 0x80, where a signed char used to sign-extend
+//  - a NACK on the data read is reported as SCDnoAckERROR with values at 0,
+//    never the values of the previous read
+//  - ns per frame of each decode path
+
+#include "mbed.h"
+#include "scd30.h"
+#include "crc8.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+int scd30_decode_session(void);
+
+namespace {
+
+const int FRAMES = 100000;
+const int RUNS = 5;
+
+uint8_t frames[FRAMES * SCD30_MEAS_FRAME_SIZE];
+scd30::Measurement decoded[FRAMES];
+uint32_t seed = 99;
+int failures = 0;
+float sink;
+
+uint32_t next_random()
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed;
+}
+
+void put_word(uint8_t *p, uint16_t w)
+{
+    p[0] = w >> 8;
+    p[1] = w;
+    p[2] = crc8_31.compute(SCD30_CRC_INIT, p, 2);
+}
+
+// readMeasurement() before the typed API: words, then ints, then floats in
+// scdSTR. The float came from *(float*)&int, memcpy here to stay defined
+struct old_decode {
+    scd30::scdSTRuct scdSTR;
+
+    uint8_t decode(const uint8_t *buff)
+    {
+        uint8_t bad = scd30::verifyFrame(buff, 6);
+        if(bad) return scd30::SCDcrcERRORv1 + bad - 1;
+        scdSTR.co2m = (buff[0] << 8) | buff[1];
+        scdSTR.co2l = (buff[3] << 8) | buff[4];
+        scdSTR.tempm = (buff[6] << 8) | buff[7];
+        scdSTR.templ = (buff[9] << 8) | buff[10];
+        scdSTR.humm = (buff[12] << 8) | buff[13];
+        scdSTR.huml = (buff[15] << 8) | buff[16];
+        scdSTR.co2i = (scdSTR.co2m << 16) | scdSTR.co2l;
+        scdSTR.tempi = (scdSTR.tempm << 16) | scdSTR.templ;
+        scdSTR.humi = (scdSTR.humm << 16) | scdSTR.huml;
+        memcpy(&scdSTR.co2f, &scdSTR.co2i, 4);
+        memcpy(&scdSTR.tempf, &scdSTR.tempi, 4);
+        memcpy(&scdSTR.humf, &scdSTR.humi, 4);
+        return scd30::SCDnoERROR;
+    }
+};
+
+bool same_bits(float a, float b)
+{
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// serves one canned reply to every read
+class reply_transport : public i2c_transport {
+    public:
+    uint8_t reply[SCD30_SN_SIZE];
+    int length = 0;
+    int readResult = 0;     // non-0: the sensor does not ack the read
+
+    virtual int write(int address, const char *data, int len, bool repeated = false) { return 0; }
+    virtual int read(int address, char *data, int len, bool repeated = false)
+    {
+        memcpy(data, reply, len < length ? len : length);
+        return readResult;
+    }
+};
+
+void check(const char *name, long value, long expected)
+{
+    printf("%-52s %9ld  expected %9ld  %s\n", name, value, expected, value == expected ? "ok" : "FAIL");
+    if (value != expected) failures++;
+}
+
+double now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+int scd30_decode_session(void)
+{
+    failures = 0;
+    for (int i = 0; i < FRAMES; i++)
+    {
+        for (int w = 0; w < 6; w++) put_word(frames + i * SCD30_MEAS_FRAME_SIZE + 3 * w, next_random() >> 16);
+    }
+
+    // same values on every path
+    old_decode old = {};
+    long wrong = 0;
+    size_t good = scd30::decodeFrames(frames, FRAMES, decoded);
+    for (int i = 0; i < FRAMES; i++)
+    {
+        const uint8_t *f = frames + i * SCD30_MEAS_FRAME_SIZE;
+        scd30::Measurement m = scd30::decodeFrame(f);
+        old.decode(f);
+        if (!same_bits(m.co2, old.scdSTR.co2f) || !same_bits(m.temp, old.scdSTR.tempf)
+            || !same_bits(m.hum, old.scdSTR.humf) || m.status != scd30::SCDnoERROR) wrong++;
+        if (memcmp(&m, &decoded[i], sizeof(m)) != 0) wrong++;
+    }
+    check("decodeFrame / decodeFrames against scdSTR path", wrong, 0);
+    check("decodeFrames: good frames", (long)good, FRAMES);
+
+    // bad CRC in each word
+    wrong = 0;
+    for (int w = 0; w < 6; w++)
+    {
+        uint8_t f[SCD30_MEAS_FRAME_SIZE];
+        memcpy(f, frames, sizeof(f));
+        f[3 * w + 2] ^= 0x01;
+        scd30::Measurement m = scd30::decodeFrame(f);
+        if (m.status != scd30::SCDcrcERRORv1 + w || m.co2 != 0) wrong++;
+    }
+    check("bad CRC in word n: SCDcrcERRORv<n>", wrong, 0);
+
+    // driver decoders with high bytes
+    reply_transport bus;
+    scd30 scd(bus);
+    bus.length = 3;
+    put_word(bus.reply, 0x0001);
+    scd.getReadyStatus();
+    check("ready status 0x0001", scd.scdSTR.ready, 1);
+    put_word(bus.reply, 0x80F3);
+    check("article code 0x80F3: CRC accepted", scd.getArticleCode(), scd30::SCDnoERROR);
+    check("article code 0x80F3", scd.scdSTR.acode, 0x80F3);
+    const char sn[] = "\xC3\x80" "SCD30" "\x9F" "0815";
+    uint8_t padded[SCD30_SN_SIZE / 3 * 2] = { 0 };
+    memcpy(padded, sn, sizeof(sn));
+    bus.length = SCD30_SN_SIZE;
+    for (int w = 0; w < SCD30_SN_SIZE / 3; w++) put_word(bus.reply + 3 * w, (padded[2 * w] << 8) | padded[2 * w + 1]);
+    check("serial number with bytes >= 0x80: CRC accepted", scd.getSerialNumber(), scd30::SCDnoERROR);
+    check("serial number with bytes >= 0x80", memcmp(scd.scdSTR.sn, sn, sizeof(sn)) != 0, 0);
+
+    // NACK on the data read after a good measurement
+    bus.length = SCD30_MEAS_FRAME_SIZE;
+    memcpy(bus.reply, frames, SCD30_MEAS_FRAME_SIZE);
+    scd30::Measurement read = scd.getMeasurement();
+    check("measurement read: status", read.status, scd30::SCDnoERROR);
+    bus.readResult = 1;
+    scd30::Measurement nack = scd.getMeasurement();
+    check("NACK on the measurement read: status", nack.status, scd30::SCDnoAckERROR);
+    check("NACK on the measurement read: values not 0", nack.co2 != 0 || nack.temp != 0 || nack.hum != 0, 0);
+    check("NACK on the ready status read", scd.getReadyStatus(), scd30::SCDnoAckERROR);
+    bus.readResult = 0;
+
+    // best of RUNS, ns per frame
+    double oldNs = 1e9, frameNs = 1e9, batchNs = 1e9;
+    for (int r = 0; r < RUNS; r++)
+    {
+        double t0 = now_ns();
+        for (int i = 0; i < FRAMES; i++)
+        {
+            old.decode(frames + i * SCD30_MEAS_FRAME_SIZE);
+            sink += old.scdSTR.co2f;
+        }
+        double t = (now_ns() - t0) / FRAMES;
+        if (t < oldNs) oldNs = t;
+
+        t0 = now_ns();
+        for (int i = 0; i < FRAMES; i++) sink += scd30::decodeFrame(frames + i * SCD30_MEAS_FRAME_SIZE).co2;
+        t = (now_ns() - t0) / FRAMES;
+        if (t < frameNs) frameNs = t;
+
+        t0 = now_ns();
+        sink += scd30::decodeFrames(frames, FRAMES, decoded);
+        t = (now_ns() - t0) / FRAMES;
+        if (t < batchNs) batchNs = t;
+    }
+    printf("ns/frame  scdSTR path: %.2f  decodeFrame: %.2f  decodeFrames: %.2f\n", oldNs, frameNs, batchNs);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+// scd30 sampler check (./brew_sim -t scd30_sampler): one hour of virtual
+// time against a simulated SCD30 on I2C, counting bus transactions per
+// delivered sample and the delay from a new sample to its read.
+//
+//  - the former C02main.cpp loop, getReadyStatus() every 250 ms, as reference
+//  - startSampling() without RDY pin, sensor clock 0.6 % fast and 0.6 % slow:
+//    the predictive poller follows the drift with about 2 status polls and
+//    one read per sample (at most 7 transactions on average)
+//  - startSampling() with the RDY pin: the edge starts the read, no polling
+//
+// No sample may be overwritten by the next one before it was read.
+
+#include "mbed.h"
+#include "scd30.h"
+#include "crc8.h"
+#include <stdio.h>
+#include <string.h>
+
+int scd30_sampler_session(void);
+
+namespace {
+
+const int RUN_MS = 3600 * 1000;
+const int INTERVAL_S = 5;
+const int I2C_TRANSFER_MS = 1;
+const int SENSOR_PHASE_MS = 1234;    // first sample, not aligned with the 250 ms polls
+const PinName RDY = PB_0;
+
+int failures = 0;
+
+// SCD30 measuring on its own clock: a new sample every periodMs, the ready
+// status and RDY pin set until the measurement is read. Async transfers
+// complete I2C_TRANSFER_MS later through the queue, as the I2C interrupt would
+class scd30_model : public i2c_transport {
+    public:
+    long produced = 0, reads = 0, missed = 0;
+    uint64_t latencySum = 0, latencyMax = 0;
+
+    scd30_model(EventQueue &queue, int periodMs, bool rdyPin) : queue(queue), periodMs(periodMs), rdyPin(rdyPin)
+    {
+        queue.call_in(SENSOR_PHASE_MS, callback(this, &scd30_model::Start));
+    }
+
+    virtual int write(int address, const char *data, int length, bool repeated = false)
+    {
+        Command(data);
+        return 0;
+    }
+
+    virtual int read(int address, char *data, int length, bool repeated = false)
+    {
+        Reply(data, length);
+        return 0;
+    }
+
+    virtual int transfer(int address, const char *tx, int txLen, char *rx, int rxLen,
+                         const event_callback_t &cb, int event, bool repeated)
+    {
+        if (txLen) Command(tx);
+        if (rxLen) Reply(rx, rxLen);
+        event_callback_t done = cb;
+        queue.call_in(I2C_TRANSFER_MS, [done]() { done(I2C_EVENT_TRANSFER_COMPLETE); });
+        return 0;
+    }
+
+    private:
+    EventQueue &queue;
+    int periodMs;
+    bool rdyPin;
+    bool ready = false;
+    uint64_t readyUs = 0;
+    uint16_t command = 0;
+
+    void Start()
+    {
+        Sample();
+        queue.call_every(periodMs, callback(this, &scd30_model::Sample));
+    }
+
+    void Sample()
+    {
+        if (ready) missed++;
+        ready = true;
+        readyUs = sim::now_us();
+        produced++;
+        if (rdyPin) sim::pin_edge(RDY, true);
+    }
+
+    void Command(const char *tx)
+    {
+        command = ((uint8_t)tx[0] << 8) | (uint8_t)tx[1];
+    }
+
+    void Word(char *p, uint16_t w)
+    {
+        p[0] = w >> 8;
+        p[1] = w;
+        p[2] = crc8_31.compute(SCD30_CRC_INIT, (const uint8_t *)p, 2);
+    }
+
+    void Reply(char *rx, int len)
+    {
+        if (command == SCD30_CMMD_GET_READY_STAT && len >= 3)
+        {
+            Word(rx, ready);
+        }
+        else if (command == SCD30_CMMD_READ_MEAS && len >= SCD30_MEAS_FRAME_SIZE)
+        {
+            float value[3] = { 800, 20, 55 };
+            for (int i = 0; i < 3; i++)
+            {
+                uint32_t u;
+                memcpy(&u, &value[i], sizeof(u));
+                Word(rx + 6 * i, u >> 16);
+                Word(rx + 6 * i + 3, u);
+            }
+            if (!ready) return;
+            uint64_t latency = sim::now_us() - readyUs;
+            latencySum += latency;
+            if (latency > latencyMax) latencyMax = latency;
+            ready = false;
+            reads++;
+            if (rdyPin) sim::pin_edge(RDY, false);
+        }
+    }
+};
+
+long delivered;
+
+void on_sample(scd30::Measurement m)
+{
+    if (m.status == scd30::SCDnoERROR) delivered++;
+}
+
+// former C02main.cpp: status every 250 ms, read when ready
+scd30 *polled;
+
+void poll_250ms()
+{
+    if (polled->getReadyStatus() == scd30::SCDnoERROR && polled->scdSTR.ready == scd30::SCDisReady)
+    {
+        if (polled->getMeasurement().status == scd30::SCDnoERROR) delivered++;
+    }
+}
+
+void run(const char *name, int periodMs, int mode, float maxPerSample)
+{
+    EventQueue queue;
+    scd30_model sensor(queue, periodMs, mode == 2);
+    scd30 scd(sensor);
+    delivered = 0;
+    if (mode == 0)
+    {
+        polled = &scd;
+        queue.call_every(250, poll_250ms);
+    }
+    else
+    {
+        scd.attachQueue(&queue);
+        scd.startSampling(INTERVAL_S, on_sample, mode == 2 ? RDY : NC);
+    }
+    queue.dispatch(RUN_MS);
+    scd.stopSampling();
+
+    float perSample = scd.transactionsPerSample();
+    bool ok = sensor.missed == 0 && delivered >= sensor.produced - 1 && perSample <= maxPerSample;
+    printf("%-28s %6d  %7ld  %9ld  %6ld  %12.2f  %8.0f  %8.0f  %s\n", name, periodMs, sensor.produced, delivered,
+           sensor.missed, perSample, sensor.reads ? sensor.latencySum / 1000.0 / sensor.reads : 0.0,
+           sensor.latencyMax / 1000.0, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+}
+
+int scd30_sampler_session(void)
+{
+    failures = 0;
+    printf("1 h, %d s interval\n", INTERVAL_S);
+    printf("sampling                     period  samples  delivered  missed  transfers/smp  mean(ms)  max(ms)\n");
+    run("getReadyStatus() every 250 ms", 5000, 0, 50);
+    run("startSampling(), no RDY", 4970, 1, 7);
+    run("startSampling(), no RDY", 5030, 1, 7);
+    run("startSampling(), RDY pin", 5000, 2, 2.05f);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+// Link between the mbed stand-ins (mbed.h) and the simulation harness.
+// All time is virtual: nothing in the firmware waits for real.
+namespace sim {
+
+    // current virtual time
+    uint64_t now_us();
+
+    // run the plant up to t_us (called by the stand-ins before anything
+    // that observes or waits for time)
+    void advance_to(uint64_t t_us);
+
+    // true once the harness has finished its profile, ends dispatch_forever()
+    bool stopped();
+
+    // heater duty written to the PwmOut, 0..1
+    void set_heater(float duty);
+
+    // level written to a DigitalOut, true when the pin belongs to the
+    // harness (the heater relay of relay_output) and is not a chip select
+    bool set_pin(int pin, int value);
+
+    // temperature seen by the RTD probe on a chip select pin
+    float probe_temperature(int cs_pin);
+
+    // cpu time spent in one EventQueue callback, for the report
+    void record_callback_ns(long ns);
+
+    // mirror the firmware debug output to stdout
+    bool verbose();
+
+    // print the report and exit, reached when dispatch_forever() runs out of profile
+    [[noreturn]] void finish();
+
+    // from the stand-ins (mbed_stubs.cpp): RTD or fault status register reads
+    // made while the 1 shot conversion of that chip was still running
+    long rtd_reads_in_conversion();
+
+    // from the stand-ins: 1 shot writes made while the previous conversion
+    // of that chip was still running (it is lost)
+    long rtd_restarted_conversions();
+
+    // from the stand-ins: fault clear writes the chip ignored because 1 shot
+    // or a fault detection cycle bit was written in the same byte
+    long rtd_ignored_fault_clears();
+
+    // fault status bits (MAX31865_FAULT_...) every simulated max31865
+    // detects from its next conversion on, 0 = healthy probe
+    void set_rtd_fault(int bits);
+
+    // from the stand-ins: run the InterruptIn callbacks of a pin for one edge
+    void pin_edge(int pin, bool rising);
+}
+
+#endif
@@ -0,0 +1,356 @@
+// Closed loop benchmark of Regulation_temperature.cpp on a simulated tank.
+//
+// Build from the repository root:
+//   g++ -std=gnu++14 -O2 -pthread -Wall -Isim -I. sim/*.cpp max31865.cpp max31865_array.cpp mash_profile.cpp relay_output.cpp scd30.cpp bus_transport.cpp bus_record.cpp crc8.cpp telemetry.cpp serial_tx.cpp autotune.cpp brew_log.cpp frame_parser.cpp -o brew_sim
+//
+// Run:
+//   ./brew_sim [Kp Ki Kd] [-a] [-p] [-x capacity losses] [-v]
+//   ./brew_sim -w brassin.bus
+//   ./brew_sim -r brassin.bus
+//   ./brew_sim -m
+//   ./brew_sim -n
+//   ./brew_sim -f
+//   ./brew_sim -o
+//   ./brew_sim -t crc8 | max31865 | rtd_table | telemetry | spsc_ring | pid | autotune | filters | brew_log | frame_parser | scd30_decode | scd30_sampler | profiler | all
+//
+//   -a  start with the firmware relay autotune, its gains are used for the rest
+//   -p  the firmware mash_profile drives the setpoint (ramps + feedforward),
+//       the harness only follows its steps; without it the setpoint jumps
+//   -x  plant mismatch: the simulated tank gets capacity x the heat capacity
+//       and losses x the losses of thermal_model::Default(), the one the
+//       firmware Cuve model (mash_profile feedforward) was identified on
+//   -w  record 24 h of max31865 and scd30 traffic on the simulated tank
+//   -r  replay a bus recording (bus_record.h) through the drivers instead of
+//       simulating, exit code 1 if the drivers diverge from the recording
+//   -m  sample rate of a max31865_array against the number of probes
+//   -n  update time per tank of tank_controller from 1 to 64 tanks
+//   -f  inject each max31865 fault code into the firmware, exit code 1 on failure
+//   -o  relay_output energy test: delivered against requested on time
+//   -t  host check and benchmark of one library module or driver (CHECKS below), or
+//       all of them, exit code 1 if any check fails
+//
+// The default profile is a step mash (52 / 63 / 72 / 78 degC). A rest starts
+// counting when the water first reaches its setpoint band. For each rest the
+// report gives settling time, overshoot and steady-state error, then the cpu
+// time spent per control iteration.
+
+#include "mbed.h"
+#include "thermal_model.h"
+#include "pid.h"
+#include "bus_replay.h"
+#include "mash_profile.h"
+#include "relay_output.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int regulation_main(void);
+int probe_array_session(void);
+int tank_controller_session(void);
+int rtd_fault_session(void);
+int relay_output_session(void);
+int crc8_session(void);
+int max31865_session(void);
+int rtd_table_session(void);
+int telemetry_session(void);
+int spsc_ring_session(void);
+int pid_session(void);
+int autotune_session(void);
+int filters_session(void);
+int brew_log_session(void);
+int frame_parser_session(void);
+int scd30_decode_session(void);
+int scd30_sampler_session(void);
+int profiler_session(void);
+extern float Kp, Ki, Kd, Temperature_consigne;
+extern bool Autoreglage, Profil_brassage;
+extern mash_profile Brassin;
+extern relay_output Relais;
+extern pid<float> Regulateur;
+
+namespace {
+
+struct rest {
+    double setpoint;        // degC
+    double hold;            // s, counted once the setpoint is reached
+};
+
+const rest PROFILE[] = {
+    { 52, 15 * 60 },        // protein rest
+    { 63, 45 * 60 },        // beta amylase
+    { 72, 20 * 60 },        // alpha amylase
+    { 78, 10 * 60 },        // mash-out
+};
+const int RESTS = sizeof(PROFILE) / sizeof(PROFILE[0]);
+
+struct check {
+    const char *name;
+    int (*run)(void);
+};
+
+const check CHECKS[] = {
+    { "crc8", crc8_session },
+    { "max31865", max31865_session },
+    { "rtd_table", rtd_table_session },
+    { "telemetry", telemetry_session },
+    { "spsc_ring", spsc_ring_session },
+    { "pid", pid_session },
+    { "autotune", autotune_session },
+    { "filters", filters_session },
+    { "brew_log", brew_log_session },
+    { "frame_parser", frame_parser_session },
+    { "scd30_decode", scd30_decode_session },
+    { "scd30_sampler", scd30_sampler_session },
+    { "profiler", profiler_session },
+};
+const int CHECK_COUNT = sizeof(CHECKS) / sizeof(CHECKS[0]);
+
+// -t name: one check, -t all: every check, a failure does not stop the others
+int check_session(const char *name)
+{
+    int failures = 0, found = 0;
+    for (int i = 0; i < CHECK_COUNT; i++)
+    {
+        if (strcmp(name, "all") != 0 && strcmp(name, CHECKS[i].name) != 0) continue;
+        found++;
+        printf("== %s\n", CHECKS[i].name);
+        if (CHECKS[i].run()) failures++;
+    }
+    if (!found)
+    {
+        printf("unknown check %s:", name);
+        for (int i = 0; i < CHECK_COUNT; i++) printf(" %s", CHECKS[i].name);
+        printf(" all\n");
+        return 2;
+    }
+    if (found > 1) printf("== %d / %d checks passed\n", found - failures, found);
+    return failures ? 1 : 0;
+}
+
+const double BAND = 0.5;                // settled when |error| <= BAND
+const double STEP_TIMEOUT = 2 * 3600;   // give up on a rest that is never reached
+const uint64_t PLANT_STEP_US = 100000;  // plant integration step
+
+struct rest_stats {
+    double start;
+    double reached;         // < 0 while not reached
+    double lastOutside;
+    double overshoot;
+    double ssSum;
+    long ssCount;
+    double end;
+};
+
+thermal_model plant(thermal_model::Default(), 20.0);
+double capacityScale = 1, lossScale = 1;   // -x, plant against the identified model
+uint64_t now = 0;
+float heater = 0;
+bool verboseOutput = false;
+bool started = false;       // the firmware runs the profile, the other sessions only use the clock
+bool done = false;
+
+int current = 0;
+rest_stats stats[RESTS];
+
+long callbacks = 0;
+long long callbackNs = 0;
+long callbackMaxNs = 0;
+std::chrono::steady_clock::time_point wallStart;
+
+double seconds(uint64_t us)
+{
+    return us / 1e6;
+}
+
+void begin_rest(int i, double t)
+{
+    memset(&stats[i], 0, sizeof(stats[i]));
+    stats[i].start = t;
+    stats[i].reached = -1;
+    stats[i].lastOutside = t;
+    if (!Profil_brassage) Temperature_consigne = PROFILE[i].setpoint;
+}
+
+// update the rest statistics and move through the profile
+void observe(double t)
+{
+    if (!started || done) return;
+
+    rest_stats &s = stats[current];
+    double err = plant.Probe() - PROFILE[current].setpoint;
+
+    if (fabs(err) > BAND) s.lastOutside = t;
+    if (s.reached < 0 && fabs(err) <= BAND) s.reached = t;
+    if (err > s.overshoot) s.overshoot = err;
+
+    double end = s.reached >= 0 ? s.reached + PROFILE[current].hold : s.start + STEP_TIMEOUT;
+    double window = s.reached >= 0 ? PROFILE[current].hold / 4 : 600;
+    if (t >= end - window)
+    {
+        s.ssSum += err;
+        s.ssCount++;
+    }
+
+    // firmware profile: its steps must be the ones of PROFILE, it decides when a rest is over
+    if (Profil_brassage)
+    {
+        if (Brassin.Step() == current) return;
+        s.end = t;
+        if (Brassin.Done())
+        {
+            done = true;
+            return;
+        }
+        begin_rest(++current, t);
+        return;
+    }
+
+    if (t >= end)
+    {
+        s.end = t;
+        if (++current == RESTS)
+        {
+            done = true;
+            return;
+        }
+        begin_rest(current, t);
+    }
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// sim.h
+
+namespace sim {
+
+uint64_t now_us()
+{
+    return now;
+}
+
+void advance_to(uint64_t t_us)
+{
+    while (now < t_us)
+    {
+        uint64_t dt = t_us - now < PLANT_STEP_US ? t_us - now : PLANT_STEP_US;
+        plant.Step(seconds(dt), heater);
+        now += dt;
+        observe(seconds(now));
+    }
+}
+
+bool stopped()
+{
+    return done;
+}
+
+void set_heater(float duty)
+{
+    heater = duty;
+}
+
+bool set_pin(int pin, int value)
+{
+    // the firmware relay (relay_output on PA_8) switches the plate
+    if (pin != PA_8) return false;
+    heater = value ? 1 : 0;
+    return true;
+}
+
+float probe_temperature(int cs_pin)
+{
+    return plant.Probe();
+}
+
+void record_callback_ns(long ns)
+{
+    callbacks++;
+    callbackNs += ns;
+    if (ns > callbackMaxNs) callbackMaxNs = ns;
+}
+
+bool verbose()
+{
+    return verboseOutput;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    float gains[3] = { Kp, Ki, Kd };
+    int n = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-v") == 0) verboseOutput = true;
+        else if (strcmp(argv[i], "-a") == 0) Autoreglage = true;
+        else if (strcmp(argv[i], "-p") == 0) Profil_brassage = true;
+        else if (strcmp(argv[i], "-x") == 0 && i + 2 < argc)
+        {
+            capacityScale = atof(argv[++i]);
+            lossScale = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) return record_session(argv[i + 1]);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) return replay_session(argv[i + 1]);
+        else if (strcmp(argv[i], "-m") == 0) return probe_array_session();
+        else if (strcmp(argv[i], "-n") == 0) return tank_controller_session();
+        else if (strcmp(argv[i], "-f") == 0) return rtd_fault_session();
+        else if (strcmp(argv[i], "-o") == 0) return relay_output_session();
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) return check_session(argv[i + 1]);
+        else if (n < 3) gains[n++] = atof(argv[i]);
+    }
+    Kp = gains[0];
+    Ki = gains[1];
+    Kd = gains[2];
+    Regulateur.SetGains(Kp, Ki, Kd);
+
+    thermal_params p = thermal_model::Default();
+    p.cPlate *= capacityScale;
+    p.cWater *= capacityScale;
+    p.kPlateAir *= lossScale;
+    p.kWaterAir *= lossScale;
+    plant = thermal_model(p, 20.0);
+
+    begin_rest(0, 0);
+    started = true;
+
+    wallStart = std::chrono::steady_clock::now();
+    regulation_main();      // never returns, dispatch_forever() ends in sim::finish()
+    return 1;
+}
+
+//-----------------------------------------------------------------------------
+// Report, called when the profile is over
+
+void sim::finish()
+{
+    std::chrono::steady_clock::time_point wallEnd = std::chrono::steady_clock::now();
+
+    printf("gains: Kp = %g  Ki = %g  Kd = %g  setpoint: %s  plant: capacity x %.2f, losses x %.2f\n", Kp, Ki, Kd,
+           Profil_brassage ? "mash_profile ramps + feedforward" : "steps", capacityScale, lossScale);
+    printf("rest  setpoint  reached(s)  settling(s)  overshoot(C)  ss error(C)\n");
+    for (int i = 0; i < RESTS && i <= current; i++)
+    {
+        rest_stats &s = stats[i];
+        if (s.reached < 0)
+        {
+            printf("%4d  %8.1f  %10s  %11s  %12.2f  %11.2f\n", i + 1, PROFILE[i].setpoint, "never", "-",
+                   s.overshoot, s.ssCount ? s.ssSum / s.ssCount : 0.0);
+            continue;
+        }
+        printf("%4d  %8.1f  %10.0f  %11.0f  %12.2f  %11.3f\n", i + 1, PROFILE[i].setpoint,
+               s.reached - s.start, s.lastOutside - s.start, s.overshoot, s.ssCount ? s.ssSum / s.ssCount : 0.0);
+    }
+    printf("batch time: %.1f min  heater energy: %.2f kWh\n", seconds(now) / 60, plant.Energy() / 3.6e6);
+    printf("relay: %u switches, on time %.1f / %.1f s requested\n", Relais.Switches(), Relais.DeliveredUs() / 1e6,
+           Relais.RequestedUs() / 1e6);
+    printf("cpu: %ld callbacks, mean %.0f ns, max %ld ns, wall %.1f ms\n", callbacks,
+           callbacks ? (double)callbackNs / callbacks : 0.0, callbackMaxNs,
+           std::chrono::duration_cast<std::chrono::microseconds>(wallEnd - wallStart).count() / 1000.0);
+    exit(0);
+}
@@ -0,0 +1,105 @@
+// spsc_ring two thread test (./brew_sim -t spsc_ring): a producer thread
+// and a consumer thread, as the control loop and the TX interrupt of
+// serial_tx, move a numbered sequence through a small ring.
+//
+// blocking: the producer retries when the ring is full, every element must
+//           come out once and in order
+// dropping: the producer gives up like serial_tx::enqueue(), what comes out
+//           must be in order and received + dropped must be the sequence
+//
+// The ring is 64 elements and the producer writes bursts of 16 to 112, so
+// the ring is full or empty most of the time and both sides keep crossing
+// each other. Needs -pthread in the sim build line.
+
+#include "spsc_ring.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+
+int spsc_ring_session(void);
+
+namespace {
+
+const unsigned COUNT = 1000000;
+const unsigned RING = 64;
+const unsigned BURST_MIN = 16;  // the producer yields after each burst, as the control loop between periods,
+const unsigned BURST_MAX = 112; // bursts longer than the ring overflow it when the consumer is late
+
+struct result {
+    unsigned received;
+    unsigned dropped;
+    unsigned outOfOrder;
+    unsigned maxCount;
+    double seconds;
+};
+
+result run(bool dropping)
+{
+    spsc_ring<uint32_t, RING> ring;
+    std::atomic<bool> producing(true);
+    result r = { 0, 0, 0, 0, 0 };
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    std::thread producer([&]() {
+        unsigned burst = BURST_MIN, inBurst = 0;
+        for (uint32_t i = 0; i < COUNT; i++)
+        {
+            while (!ring.push(i))
+            {
+                if (dropping)
+                {
+                    r.dropped++;
+                    break;
+                }
+                std::this_thread::yield();
+            }
+            unsigned n = ring.count();
+            if (n > r.maxCount) r.maxCount = n;
+            if (++inBurst == burst)
+            {
+                std::this_thread::yield();
+                inBurst = 0;
+                burst = BURST_MIN + (burst * 37) % (BURST_MAX - BURST_MIN + 1);
+            }
+        }
+        producing.store(false, std::memory_order_release);
+    });
+
+    // consumer: this thread
+    uint32_t expected = 0, v;
+    for (;;)
+    {
+        if (!ring.pop(v))
+        {
+            if (!producing.load(std::memory_order_acquire) && ring.empty()) break;
+            std::this_thread::yield();
+            continue;
+        }
+        // blocking: exactly the next one, dropping: anything after the last one
+        if (dropping ? v < expected : v != expected) r.outOfOrder++;
+        expected = v + 1;
+        r.received++;
+    }
+    producer.join();
+    r.seconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count() / 1e6;
+    return r;
+}
+
+}
+
+int spsc_ring_session(void)
+{
+    int failures = 0;
+    printf("mode      received  dropped  out of order  max count  Melem/s\n");
+    for (int dropping = 0; dropping < 2; dropping++)
+    {
+        result r = run(dropping);
+        bool ok = r.outOfOrder == 0 && r.maxCount <= RING && r.received + r.dropped == COUNT
+                  && (dropping || r.dropped == 0);
+        printf("%-8s  %8u  %7u  %12u  %9u  %7.1f  %s\n", dropping ? "dropping" : "blocking", r.received, r.dropped,
+               r.outOfOrder, r.maxCount, r.received / r.seconds / 1e6, ok ? "ok" : "FAIL");
+        if (!ok) failures++;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+// Multi-tank benchmark (./brew_sim -n): cpu time of one control update per
+// tank for 1 to 64 tanks, tank_controller (one array per field) against one
+// pid<float> object per tank. Both see the same measurements, their outputs
+// must match exactly.
+
+#include "mbed.h"
+#include "tank_controller.h"
+#include "pid.h"
+#include <chrono>
+#include <stdio.h>
+
+int tank_controller_session(void);
+
+namespace {
+
+const int MAX_TANKS = 64;
+const int PERIODS = 20000;
+const int RUNS = 5;
+
+tank_controller<float, MAX_TANKS> engine(1.0f);
+pid<float> *single[MAX_TANKS];
+float measurement[MAX_TANKS];
+float sink;
+
+// slow drift around each setpoint, different for every tank
+void plant_step(int n, int k)
+{
+    for (int i = 0; i < n; i++)
+    {
+        measurement[i] = 50 + (i % 7) + 0.01f * ((k * (i + 3)) % 200) - 1;
+    }
+}
+
+double now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+int tank_controller_session(void)
+{
+    for (int i = 0; i < MAX_TANKS; i++)
+    {
+        float kp = 0.3f + 0.01f * i, ki = 0.002f, kd = 5.0f, tf = 2.0f;
+        engine.Add(kp, ki, kd, tf);
+        engine.SetSetpoint(i, 50 + (i % 7));
+        single[i] = new pid<float>(kp, ki, kd, 1.0f, tf);
+        single[i]->SetSetpoint(50 + (i % 7));
+    }
+
+    // same results, period by period
+    long mismatches = 0;
+    for (int k = 0; k < PERIODS; k++)
+    {
+        plant_step(MAX_TANKS, k);
+        engine.Update(measurement);
+        for (int i = 0; i < MAX_TANKS; i++)
+        {
+            if (single[i]->Update(measurement[i]) != engine.Output(i)) mismatches++;
+        }
+    }
+
+    printf("tanks  engine(ns/tank)  pid objects(ns/tank)\n");
+    for (int n = 1; n <= MAX_TANKS; n *= 2)
+    {
+        tank_controller<float, MAX_TANKS> part(1.0f);
+        for (int i = 0; i < n; i++)
+        {
+            part.Add(0.3f + 0.01f * i, 0.002f, 5.0f, 2.0f);
+            part.SetSetpoint(i, 50 + (i % 7));
+        }
+
+        // best of RUNS, the host scheduler adds noise
+        double engineNs = 1e9, singleNs = 1e9;
+        for (int r = 0; r < RUNS; r++)
+        {
+            double t0 = now_ns();
+            for (int k = 0; k < PERIODS; k++)
+            {
+                measurement[k % n] += 1e-4f;
+                part.Update(measurement);
+                sink += part.Output(k % n);
+            }
+            double t = (now_ns() - t0) / PERIODS / n;
+            if (t < engineNs) engineNs = t;
+
+            t0 = now_ns();
+            for (int k = 0; k < PERIODS; k++)
+            {
+                measurement[k % n] += 1e-4f;
+                for (int i = 0; i < n; i++)
+                {
+                    single[i]->Update(measurement[i]);
+                }
+                sink += single[k % n]->Output();
+            }
+            t = (now_ns() - t0) / PERIODS / n;
+            if (t < singleNs) singleNs = t;
+        }
+
+        printf("%5d  %15.2f  %20.2f\n", n, engineNs, singleNs);
+    }
+
+    printf("output mismatches against pid<float>: %ld\n", mismatches);
+    for (int i = 0; i < MAX_TANKS; i++)
+    {
+        delete single[i];
+    }
+    return mismatches ? 1 : 0;
+}
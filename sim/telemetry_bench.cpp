@@ -0,0 +1,160 @@
+// Telemetry frame check and benchmark (./brew_sim -t telemetry): random
+// frames of 0..8 channels survive encode + decode unchanged, every single
+// bit flip of a frame is rejected, a truncated frame waits for more bytes.
+// Then encode and decode throughput, and the wire cost of five brewery
+// channels (fails if not below five ASCII Envoie_Donners frames) and of the
+// single temperature of Envoie_Trame.
+
+#include "mbed.h"
+#include "telemetry.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+int telemetry_session(void);
+
+namespace {
+
+const int FRAMES = 20000;
+const int RUNS = 5;
+const int ASCII_FRAME_SIZE = 6;     // 0xAA, type, 3 digits, 0xF0
+const uint8_t TYPES[] = { TELEMETRY_TEMPERATURE, TELEMETRY_HUMIDITE, TELEMETRY_PH, TELEMETRY_CO2,
+                          TELEMETRY_VISCOSITE };
+
+uint32_t seed = 12345;
+unsigned sink;
+
+uint32_t next_random()
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+void random_frame(telemetryFrame &f, int count)
+{
+    f.seq = next_random();
+    f.timestamp = next_random() * 97;
+    f.count = count;
+    for (int i = 0; i < count; i++)
+    {
+        f.channel[i].type = TYPES[next_random() % 5];
+        f.channel[i].value = (int32_t)(next_random() * 2654435761u);   // full 32 bit range, negatives too
+    }
+}
+
+// measures as the senders fill them, the varints take 2 or 3 bytes
+void plant_frame(telemetryFrame &f, int count)
+{
+    static const int32_t RANGE[][2] = { { 1500, 10500 }, { 3000, 9500 }, { 400, 700 }, { 40000, 500000 },
+                                        { 100, 2000 } };
+    f.seq = next_random();
+    f.timestamp = next_random();
+    f.count = count;
+    for (int i = 0; i < count; i++)
+    {
+        f.channel[i].type = TYPES[i % 5];
+        f.channel[i].value = RANGE[i % 5][0] + next_random() % (RANGE[i % 5][1] - RANGE[i % 5][0]);
+    }
+}
+
+bool same(const telemetryFrame &a, const telemetryFrame &b)
+{
+    if (a.seq != b.seq || a.timestamp != b.timestamp || a.count != b.count) return false;
+    for (int i = 0; i < a.count; i++)
+    {
+        if (a.channel[i].type != b.channel[i].type || a.channel[i].value != b.channel[i].value) return false;
+    }
+    return true;
+}
+
+double now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+int telemetry_session(void)
+{
+    int failures = 0;
+    uint8_t buff[TELEMETRY_MAX_FRAME_SIZE];
+    telemetryFrame in, out;
+
+    // round trip
+    long wrong = 0;
+    for (int k = 0; k < FRAMES; k++)
+    {
+        random_frame(in, k % (TELEMETRY_MAX_CHANNELS + 1));
+        int len = telemetryEncode(in, buff, sizeof(buff));
+        if (len <= 0 || len > TELEMETRY_FRAME_SIZE(in.count) || telemetryDecode(buff, len, out) != len || !same(in, out)) wrong++;
+    }
+    printf("round trip of %d frames: %ld wrong  %s\n", FRAMES, wrong, wrong ? "FAIL" : "ok");
+    if (wrong) failures++;
+
+    // single bit errors and truncation on a five channel frame
+    random_frame(in, 5);
+    int len = telemetryEncode(in, buff, sizeof(buff));
+    long accepted = 0, flips = 0;
+    for (int i = 0; i < len; i++)
+    {
+        for (int bit = 0; bit < 8; bit++)
+        {
+            buff[i] ^= 1 << bit;
+            if (telemetryDecode(buff, len, out) > 0) accepted++;
+            buff[i] ^= 1 << bit;
+            flips++;
+        }
+    }
+    int notComplete = 0;
+    for (int n = 1; n < len; n++)
+    {
+        if (telemetryDecode(buff, n, out) != TELincomplete) notComplete++;
+    }
+    bool ok = !accepted && !notComplete;
+    printf("%ld single bit errors: %ld accepted, %d truncations not waiting  %s\n", flips, accepted, notComplete,
+           ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+
+    // throughput, best of RUNS
+    static uint8_t stream[FRAMES][TELEMETRY_MAX_FRAME_SIZE];
+    static telemetryFrame frames[64];
+    int size = 0;
+    for (int i = 0; i < 64; i++)
+    {
+        plant_frame(frames[i], 5);
+        size += telemetryEncode(frames[i], buff, sizeof(buff));
+    }
+    size = (size + 32) / 64;
+    double encodeNs = 1e9, decodeNs = 1e9;
+    for (int r = 0; r < RUNS; r++)
+    {
+        double t0 = now_ns();
+        for (int k = 0; k < FRAMES; k++)
+        {
+            sink += telemetryEncode(frames[k & 63], stream[k], TELEMETRY_MAX_FRAME_SIZE);
+        }
+        double t = (now_ns() - t0) / FRAMES;
+        if (t < encodeNs) encodeNs = t;
+
+        t0 = now_ns();
+        for (int k = 0; k < FRAMES; k++)
+        {
+            sink += telemetryDecode(stream[k], TELEMETRY_MAX_FRAME_SIZE, out);
+        }
+        t = (now_ns() - t0) / FRAMES;
+        if (t < decodeNs) decodeNs = t;
+    }
+    printf("5 channel frame (%d bytes)  encode: %.1f ns (%.0f MB/s)  decode: %.1f ns (%.0f MB/s)\n", size, encodeNs,
+           size * 1e3 / encodeNs, decodeNs, size * 1e3 / decodeNs);
+
+    plant_frame(in, 1);
+    int single = telemetryEncode(in, buff, sizeof(buff));
+    ok = size < 5 * ASCII_FRAME_SIZE;
+    printf("5 channels on the wire  binary: %d bytes, 0.01 resolution, seq + timestamp + CRC  %s\n", size,
+           ok ? "ok" : "FAIL");
+    printf("                        ASCII:  %d bytes, 0.1 resolution, 0..99.9, no check\n", 5 * ASCII_FRAME_SIZE);
+    printf("1 channel on the wire   binary: %d bytes, ASCII: %d bytes\n", single, ASCII_FRAME_SIZE);
+    if (!ok) failures++;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,37 @@
+#include "thermal_model.h"
+
+thermal_model::thermal_model(const thermal_params &p, double initial) : p(p)
+{
+    plate = water = probe = initial;
+    energy = 0;
+}
+
+void thermal_model::Step(double dt, double u)
+{
+    if (u < 0) u = 0;
+    if (u > 1) u = 1;
+
+    double toWater = p.kPlateWater * (plate - water);
+    double dPlate = (u * p.power - toWater - p.kPlateAir * (plate - p.ambient)) / p.cPlate;
+    double dWater = (toWater - p.kWaterAir * (water - p.ambient)) / p.cWater;
+
+    plate += dPlate * dt;
+    water += dWater * dt;
+    probe += (water - probe) * dt / p.probeTau;
+    energy += u * p.power * dt;
+}
+
+thermal_params thermal_model::Default()
+{
+    // 20 L of water on a 1.8 kW plate
+    thermal_params p;
+    p.power = 1800;
+    p.cPlate = 3000;
+    p.cWater = 20 * 4186;
+    p.kPlateWater = 150;
+    p.kPlateAir = 3;
+    p.kWaterAir = 6;
+    p.ambient = 20;
+    p.probeTau = 10;
+    return p;
+}
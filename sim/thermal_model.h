@@ -0,0 +1,42 @@
+#ifndef THERMAL_MODEL_H
+#define THERMAL_MODEL_H
+
+// Lumped two node model of the brewing tank
+//
+//   plate:  Cp dTp/dt = u P - Kpw (Tp - Tw) - Kpa (Tp - Ta)
+//   water:  Cw dTw/dt = Kpw (Tp - Tw) - Kwa (Tw - Ta)
+//   probe:  tau dTs/dt = Tw - Ts
+//
+// u is the relay duty (0..1), averaged over one PWM period.
+struct thermal_params {
+    double power;           // heater power (W)
+    double cPlate;          // plate heat capacity (J/K)
+    double cWater;          // water heat capacity (J/K)
+    double kPlateWater;     // plate -> water conductance (W/K)
+    double kPlateAir;       // plate -> air losses (W/K)
+    double kWaterAir;       // water -> air losses (W/K)
+    double ambient;         // air temperature (degC)
+    double probeTau;        // probe time constant (s)
+};
+
+class thermal_model {
+    public:
+
+    thermal_model(const thermal_params &p, double initial);
+
+    // integrate dt seconds with heater duty u
+    void Step(double dt, double u);
+
+    double Water() const { return water; }
+    double Plate() const { return plate; }
+    double Probe() const { return probe; }
+    double Energy() const { return energy; }
+
+    static thermal_params Default();
+
+    private:
+    thermal_params p;
+    double plate, water, probe, energy;
+};
+
+#endif
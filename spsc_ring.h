@@ -0,0 +1,56 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+
+// Single producer / single consumer lock-free ring buffer.
+// One side may be an interrupt handler: push() and pop() never block and
+// never disable interrupts. N must be a power of two.
+template <typename T, unsigned N>
+class spsc_ring {
+
+public:
+    spsc_ring() : head(0), tail(0) {}
+
+    /** Producer side: add one element
+     *
+     * @return false if the ring is full (element dropped)
+     */
+    bool push(const T &v) {
+        unsigned h = head.load(std::memory_order_relaxed);
+        if(h - tail.load(std::memory_order_acquire) == N) return false;
+        buff[h & (N - 1)] = v;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Consumer side: remove one element
+     *
+     * @return false if the ring is empty
+     */
+    bool pop(T &v) {
+        unsigned t = tail.load(std::memory_order_relaxed);
+        if(head.load(std::memory_order_acquire) == t) return false;
+        v = buff[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Number of elements waiting, exact from either side */
+    unsigned count() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const {
+        return count() == 0;
+    }
+
+private:
+    static_assert(N && (N & (N - 1)) == 0, "spsc_ring size must be a power of two");
+
+    std::atomic<unsigned> head;     // written by the producer only
+    std::atomic<unsigned> tail;     // written by the consumer only
+    T buff[N];
+};
+
+#endif
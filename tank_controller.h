@@ -0,0 +1,134 @@
+#ifndef TANK_CONTROLLER_H
+#define TANK_CONTROLLER_H
+
+#include "mbed.h"
+#include "pid.h"
+#include "relay_output.h"
+
+// PID regulation of up to N tanks in one object, T = float or q16_16.
+//
+// Same control law as pid.h, through the same free functions: pid_law() each
+// period (clamped output, conditional integration, filtered derivative on
+// measurement), pid_gains() and pid_setpoint() for bumpless changes and
+// pid_reset(). Only the storage differs, the state is kept field by field:
+// one array per coefficient and per state variable, index = tank. Update()
+// is a single loop over all tanks that walks each array in order, no object
+// per tank and no virtual call.
+//
+// Each tank reads its measurement from a sensor index (e.g. the probe
+// number of a max31865_array) and may drive a relay_output:
+//
+//   tank_controller<float, 4> Cuves(1.0);             // 1 s period
+//   int c = Cuves.Add(0.5, 0.002, 0);
+//   Cuves.BindSensor(c, 0);
+//   Cuves.BindOutput(c, &Relais);
+//   Cuves.SetSetpoint(c, 63);
+//   ...
+//   Cuves.Update(temperatures);                       // temperatures[sensor]
+//   Cuves.Apply();                                    // relay_output writes
+template <typename T, int N>
+class tank_controller {
+    public:
+
+    tank_controller(float dt) : dt(dt), count(0) {}
+
+    // new tank with its gains, index of the tank or -1 when all N are used
+    int Add(float kp, float ki, float kd, float tf = 0, float outMin = 0, float outMax = 1)
+    {
+        if (count == N) return -1;
+        int i = count++;
+        sp[i] = integ[i] = deriv[i] = prevMeas[i] = lastError[i] = out[i] = T(0.0f);
+        first[i] = true;
+        sensor[i] = i;
+        output[i] = NULL;
+        this->kp[i] = T(0.0f);
+        this->tf[i] = tf;
+        SetLimits(i, outMin, outMax);
+        SetGains(i, kp, ki, kd);
+        return i;
+    }
+
+    // measurement of tank i is measurement[sensor] in Update(), default sensor = i
+    void BindSensor(int i, int sensor) { this->sensor[i] = sensor; }
+
+    // relay_output written by Apply(), NULL = output only read with Output()
+    void BindOutput(int i, relay_output *output) { this->output[i] = output; }
+
+    // new gains, the output does not jump
+    void SetGains(int i, float kp, float ki, float kd)
+    {
+        pid_gains(kp, ki, kd, dt, tf[i], ki != 0 && !first[i], this->kp[i], kiDt[i], kdDt[i], alpha[i], integ[i],
+                  lastError[i]);
+        this->ki[i] = ki;
+    }
+
+    void SetLimits(int i, float outMin, float outMax)
+    {
+        this->outMin[i] = T(outMin);
+        this->outMax[i] = T(outMax);
+    }
+
+    // new setpoint, bumpless when ki != 0
+    void SetSetpoint(int i, T setpoint)
+    {
+        pid_setpoint(setpoint, ki[i] != 0 && !first[i], kp[i], sp[i], integ[i], lastError[i]);
+    }
+
+    // restart tank i from the current plant state, integral preloaded so the first output is u
+    void Reset(int i, T measurement, T u)
+    {
+        out[i] = pid_reset(sp[i], measurement, u, kp[i], outMin[i], outMax[i], integ[i], deriv[i], prevMeas[i],
+                           lastError[i]);
+        first[i] = false;
+    }
+
+    // one period for every tank
+    void Update(const T measurement[])
+    {
+        for (int i = 0; i < count; i++)
+        {
+            T m = measurement[sensor[i]];
+            if (first[i])
+            {
+                prevMeas[i] = m;
+                first[i] = false;
+            }
+
+            out[i] = pid_law(sp[i], m, kp[i], kiDt[i], kdDt[i], alpha[i], outMin[i], outMax[i],
+                             integ[i], deriv[i], prevMeas[i], lastError[i]);
+        }
+    }
+
+    // outputs to the bound relay_output, kept apart from Update() so the compute pass does no I/O
+    void Apply()
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (output[i]) output[i]->write((float)out[i]);
+        }
+    }
+
+    int Count() const { return count; }
+    T Setpoint(int i) const { return sp[i]; }
+    T Output(int i) const { return out[i]; }
+    T Integral(int i) const { return integ[i]; }
+    T Derivative(int i) const { return deriv[i]; }
+
+    private:
+    float dt;
+    int count;
+
+    // coefficients
+    float tf[N], ki[N];
+    T kp[N], kiDt[N], kdDt[N], alpha[N], outMin[N], outMax[N];
+
+    // state
+    T sp[N], integ[N], deriv[N], prevMeas[N], lastError[N], out[N];
+    bool first[N];
+
+    // bindings
+    int sensor[N];
+    relay_output *output[N];
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "telemetry.h"
+#include "crc8.h"
+
+//-----------------------------------------------------------------------------
+// Helpers shared by the encoder and the decoder
+
+static uint32_t ZigZag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t UnZigZag(uint32_t z)
+{
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+static int VarintSize(uint32_t v)
+{
+    int n = 1;
+    while(v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+//-----------------------------------------------------------------------------
+// Encoder
+
+int telemetryEncode(const telemetryFrame &frame, uint8_t *buff, int size)
+{
+    if(frame.count > TELEMETRY_MAX_CHANNELS) return TELcountERROR;
+    int len = TELEMETRY_HEADER_SIZE + TELEMETRY_TRAILER_SIZE + frame.count;
+    for(int i = 0; i < frame.count; i++) {
+        len += VarintSize(ZigZag(frame.channel[i].value));
+    }
+    if(len > size) return TELsizeERROR;
+
+    uint8_t *p = buff;
+    *p++ = TELEMETRY_START;
+    *p++ = (TELEMETRY_VERSION << 4) | frame.count;
+    *p++ = frame.seq;
+    *p++ = frame.timestamp >> 8;
+    *p++ = frame.timestamp & 255;
+    for(int i = 0; i < frame.count; i++) {
+        uint32_t z = ZigZag(frame.channel[i].value);
+        *p++ = frame.channel[i].type;
+        while(z >= 0x80) {
+            *p++ = (z & 0x7F) | 0x80;
+            z >>= 7;
+        }
+        *p++ = z;
+    }
+    *p = crc8_31.compute(0xff, buff + 1, p - buff - 1);
+    p++;
+    *p++ = TELEMETRY_END;
+
+    return len;
+}
+
+//-----------------------------------------------------------------------------
+// Decoder
+
+int telemetryDecode(const uint8_t *buff, int len, telemetryFrame &frame)
+{
+    if(len < 1) return TELincomplete;
+    if(buff[0] != TELEMETRY_START) return TELstartERROR;
+    if(len < 2) return TELincomplete;
+    if((buff[1] >> 4) != TELEMETRY_VERSION) return TELversionERROR;
+    int count = buff[1] & 15;
+    if(count > TELEMETRY_MAX_CHANNELS) return TELcountERROR;
+
+    // values have no fixed size: walk the channels to find the crc,
+    // frame is only written once the crc matched
+    telemetryChannel channel[TELEMETRY_MAX_CHANNELS];
+    const uint8_t *p = buff + TELEMETRY_HEADER_SIZE;
+    const uint8_t *end = buff + len;
+    for(int i = 0; i < count; i++) {
+        if(p >= end) return TELincomplete;
+        channel[i].type = *p++;
+        uint32_t z = 0;
+        for(int shift = 0; ; shift += 7) {
+            if(shift > 28) return TELvalueERROR;
+            if(p >= end) return TELincomplete;
+            uint8_t c = *p++;
+            z |= (uint32_t)(c & 0x7F) << shift;
+            if(!(c & 0x80)) break;
+        }
+        channel[i].value = UnZigZag(z);
+    }
+    int size = p - buff + TELEMETRY_TRAILER_SIZE;
+    if(len < size) return TELincomplete;
+
+    if(crc8_31.compute(0xff, buff + 1, size - 3) != buff[size - 2]) return TELcrcERROR;
+    if(buff[size - 1] != TELEMETRY_END) return TELendERROR;
+
+    frame.seq = buff[2];
+    frame.count = count;
+    frame.timestamp = (buff[3] << 8) | buff[4];
+    for(int i = 0; i < count; i++) frame.channel[i] = channel[i];
+
+    return size;
+}
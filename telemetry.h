@@ -0,0 +1,81 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+// Binary inter-MCU frame, shared by the sender and the receiver
+//
+//   0xAA | version << 4 | count | seq | timestamp (2) | count x [type | value (1..5)] | crc | 0xF0
+//
+// The timestamp is the low 16 bits of the sender time in ms, big-endian:
+// it wraps every 65.5 s, the receiver extends it with its own clock. Values
+// are fixed point, measure * TELEMETRY_SCALE, so 0.01 resolution and no 99.9
+// limit, sent zigzag coded in a varint (7 bits per byte, low bits first, top
+// bit set when another byte follows): 2 bytes up to +-81.91, 3 up to
+// +-10485.75. The CRC-8 (poly 0x31, init 0xFF) covers everything from the
+// version to the last channel.
+
+#define TELEMETRY_START                 0xAA
+#define TELEMETRY_END                   0xF0
+#define TELEMETRY_VERSION               0x03    // 0x02 = 4 byte timestamp and values, separate count byte
+
+#define TELEMETRY_MAX_CHANNELS          8
+#define TELEMETRY_SCALE                 100
+
+#define TELEMETRY_HEADER_SIZE           5       // start, version + count, seq, timestamp
+#define TELEMETRY_CHANNEL_SIZE          6       // type, value (worst case)
+#define TELEMETRY_TRAILER_SIZE          2       // crc, end
+#define TELEMETRY_FRAME_SIZE(n)         (TELEMETRY_HEADER_SIZE + (n) * TELEMETRY_CHANNEL_SIZE + TELEMETRY_TRAILER_SIZE)
+#define TELEMETRY_MAX_FRAME_SIZE        TELEMETRY_FRAME_SIZE(TELEMETRY_MAX_CHANNELS)
+
+// channel types, same codes as the ASCII frame
+#define TELEMETRY_TEMPERATURE           0x54
+#define TELEMETRY_HUMIDITE              0x48
+#define TELEMETRY_PH                    0x50
+#define TELEMETRY_CO2                   0x43
+#define TELEMETRY_VISCOSITE             0x56
+
+enum TELerror {
+    TELincomplete   =  0,   //need more bytes
+    TELstartERROR   = -1,   //first byte is not TELEMETRY_START
+    TELversionERROR = -2,   //unknown version
+    TELcountERROR   = -3,   //too many channels
+    TELcrcERROR     = -4,   //CRC mismatch
+    TELendERROR     = -5,   //last byte is not TELEMETRY_END
+    TELsizeERROR    = -6,   //output buffer too small
+    TELvalueERROR   = -7,   //value longer than 5 bytes
+};
+
+struct telemetryChannel {
+    uint8_t type;           /**< TELEMETRY_... channel type */
+    int32_t value;          /**< measure * TELEMETRY_SCALE */
+};
+
+struct telemetryFrame {
+    uint8_t seq;            /**< sequence number, wraps at 255 */
+    uint16_t timestamp;     /**< sender time in ms, low 16 bits */
+    uint8_t count;          /**< number of valid channels */
+    telemetryChannel channel[TELEMETRY_MAX_CHANNELS];
+};
+
+    /** Build a binary frame
+     *
+     * @param frame to send
+     * @param output buffer (TELEMETRY_FRAME_SIZE(count) is always enough)
+     * @param size of the output buffer
+     *
+     * @return frame length in bytes, or enum TELerror
+     */
+int telemetryEncode(const telemetryFrame &frame, uint8_t *buff, int size);
+
+    /** Decode a binary frame starting at buff[0]
+     *
+     * @param received bytes
+     * @param number of bytes available
+     * @param decoded frame
+     *
+     * @return frame length in bytes, TELincomplete, or enum TELerror
+     */
+int telemetryDecode(const uint8_t *buff, int len, telemetryFrame &frame);
+
+#endif